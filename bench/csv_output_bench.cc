@@ -0,0 +1,71 @@
+/*
+ * Compare the time to write vectors as text with VectorFile::write_csv, on
+ * one thread and on several, against that of the former writer: operator<<
+ * of each row, copied first, and a flush at each line.  The vectors are
+ * random points of a hyperboloid-like range of magnitudes, written to a
+ * temporary file.
+ *
+ * Usage: csv_output_bench [rows] [dimension] [threads]
+ */
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "dictionary.h"
+#include "random.h"
+#include "vector.h"
+#include "vector_file.h"
+
+using namespace minkowski;
+
+int main(int argc, char** argv) {
+    const int64_t rows = argc > 1 ? std::stoll(argv[1]) : 200000;
+    const int64_t dimension = argc > 2 ? std::stoll(argv[2]) : 50;
+    const int32_t threads = argc > 3 ? std::stoi(argv[3]) : 4;
+
+    Rng rng(5);
+    std::vector<entry> words(rows);
+    std::vector<Vector> vectors(rows, Vector(dimension));
+    for (int64_t i = 0; i < rows; i++) {
+        words[i].word = "word" + std::to_string(i);
+        for (int64_t j = 0; j < dimension; j++) {
+            vectors[i][j] = (real(rng()) / 1e19 - 0.9) * (j == 0 ? 10. : 1.);
+        }
+    }
+    const std::string path = "/tmp/minkowski-csv-bench-" + std::to_string(getpid()) + ".csv";
+    std::cout << rows << " rows of dimension " << dimension << std::endl;
+
+    double former_secs = 0;
+    for (int32_t n : {0, 1, threads}) {
+        auto start = std::chrono::steady_clock::now();
+        std::ofstream ofs(path, std::ios::binary);
+        if (n == 0) {
+            Vector vec(dimension);
+            for (int64_t i = 0; i < rows; i++) {
+                vec = vectors.at(i);
+                ofs << words[i].word << " " << vec << std::endl;
+            }
+        } else {
+            VectorFile::write_csv(ofs, words, vectors, rows, dimension, n);
+        }
+        ofs.close();
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        int64_t size = in.tellg();
+        if (n == 0) {
+            former_secs = secs;
+            std::cout << "operator<<:            ";
+        } else {
+            std::cout << "write_csv, " << n << " thread" << (n > 1 ? "s: " : ":  ") << std::string(8 - std::to_string(n).size(), ' ');
+        }
+        std::cout << size / secs / 1e6 << " MB/sec (" << secs / former_secs << "x the time), "
+                  << size / 1000000 << " MB" << std::endl;
+    }
+    std::remove(path.c_str());
+    return 0;
+}
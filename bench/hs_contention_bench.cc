@@ -0,0 +1,161 @@
+/*
+ * Measure the throughput of training the skip-gram pairs with the
+ * hierarchical softmax on several threads, and how often the locks of the
+ * nodes of the Huffman tree are contended, for -lock-policy skip and sorted.
+ * For comparison, "blocking" waits for the lock of every node on the path,
+ * as training did before nodes were try-locked; the nodes near the root are
+ * on most paths, so this serializes the threads.  The corpus is synthetic:
+ * lines of word ids drawn from a Zipf distribution.  Speedups are relative
+ * to one thread of the same policy (and so only meaningful on as many cores
+ * as threads).
+ *
+ * Usage: hs_contention_bench [vocab size] [dimension] [lines] [max threads]
+ */
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "alias_table.h"
+#include "args.h"
+#include "huffman_tree.h"
+#include "minkowski.h"
+#include "model.h"
+#include "random.h"
+#include "vector.h"
+
+using namespace minkowski;
+
+/*
+ * Exposes the setup of the vectors and of the Huffman tree without a
+ * dictionary.
+ */
+class ContentionBench : public Minkowski {
+public:
+    ContentionBench(std::shared_ptr<Args> args, const std::vector<int64_t>& counts) : Minkowski(args) {
+        Rng rng(args->seed);
+        Vector init_vector(args->dimension);
+        vectors_ = std::make_shared<std::vector<Vector>>();
+        for (size_t i = 0; i < counts.size(); i++) {
+            random_hyperboloid_point(init_vector, rng, args->init_std_dev);
+            vectors_->push_back(init_vector);
+        }
+        tree_ = std::make_shared<HuffmanTree>(counts);
+        init_vector.zero();
+        init_vector[args->dimension - 1] = 1.;
+        for (int32_t i = 0; i < tree_->internal_nodes(); i++) {
+            vectors_->push_back(init_vector);
+        }
+        vector_flags_ = std::shared_ptr<std::vector<std::mutex>>(new std::vector<std::mutex>(vectors_->size()));
+        generate_negative_samples(counts);
+        create_replicas();
+    }
+
+    /*
+     * Train the pairs of every `threads`th line, starting at `first`, locking
+     * all the nodes of each path, waiting as necessary.
+     */
+    void train_blocking(const std::vector<std::vector<int32_t>>& lines, int32_t first, int32_t threads, LockStats& stats) {
+        Model model(vectors_, args_);
+        std::vector<int32_t> lock_order;
+        for (size_t l = first; l < lines.size(); l += threads) {
+            auto& line = lines[l];
+            for (int32_t w = 0; w < line.size(); w++) {
+                for (int32_t c = -args_->window_size; c <= args_->window_size; c++) {
+                    if (c == 0 || w + c < 0 || w + c >= line.size() || line[w] == line[w + c]) {
+                        continue;
+                    }
+                    int32_t source = line[w];
+                    const std::vector<int32_t>& path = tree_->path(line[w + c]);
+                    lock_order.assign(path.begin(), path.end());
+                    lock_order.push_back(source);
+                    std::sort(lock_order.begin(), lock_order.end());
+                    for (auto id : lock_order) {
+                        vector_flags_->at(id).lock();
+                    }
+                    model.hierarchical_softmax(source, path, tree_->code(line[w + c]), 0.01);
+                    for (auto id : lock_order) {
+                        vector_flags_->at(id).unlock();
+                    }
+                    stats.pairs_trained++;
+                }
+            }
+        }
+    }
+
+    /*
+     * As train_blocking, as training does.
+     */
+    void train(const std::vector<std::vector<int32_t>>& lines, int32_t first, int32_t threads, LockStats& stats) {
+        Model model(vectors_, args_);
+        Rng rng(args_->seed + first);
+        for (size_t l = first; l < lines.size(); l += threads) {
+            skipgram(model, replicas_[0], 0.01, lines[l], 0, lines[l].size(), rng, stats);
+        }
+    }
+};
+
+int main(int argc, char** argv) {
+    const int32_t vocab_size = argc > 1 ? std::stoi(argv[1]) : 100000;
+    auto args = std::make_shared<Args>();
+    args->dimension = argc > 2 ? std::stoi(argv[2]) : 100;
+    int32_t num_lines = argc > 3 ? std::stoi(argv[3]) : 200;
+    const int32_t max_threads = argc > 4 ? std::stoi(argv[4]) : 8;
+    const int32_t line_length = 1000;
+    args->loss = loss_name::hs;
+
+    std::vector<int64_t> counts(vocab_size);
+    std::vector<real> zipf(vocab_size);
+    for (int32_t i = 0; i < vocab_size; i++) {
+        counts[i] = 1 + 100000000 / (i + 1);
+        zipf[i] = counts[i];
+    }
+    AliasTable corpus_distribution(zipf);
+    Rng rng(2);
+    std::vector<std::vector<int32_t>> lines(num_lines);
+    for (auto& line : lines) {
+        for (int32_t i = 0; i < line_length; i++) {
+            line.push_back(corpus_distribution.sample(rng));
+        }
+    }
+
+    std::cout << "vocab " << vocab_size << ", dimension " << args->dimension << ", window " << args->window_size
+              << ", " << std::thread::hardware_concurrency() << " cores\n";
+    for (std::string policy : {"blocking", "skip", "sorted"}) {
+        args->lock_policy = policy == "sorted" ? lock_policy_name::sorted : lock_policy_name::skip;
+        double single_thread_rate = 0;
+        for (int32_t threads = 1; threads <= max_threads; threads *= 2) {
+            ContentionBench bench(args, counts);
+            std::vector<LockStats> stats(threads);
+            std::vector<std::thread> workers;
+            auto start = std::chrono::steady_clock::now();
+            for (int32_t t = 0; t < threads; t++) {
+                workers.push_back(std::thread([&, t]() {
+                    if (policy == "blocking") {
+                        bench.train_blocking(lines, t, threads, stats[t]);
+                    } else {
+                        bench.train(lines, t, threads, stats[t]);
+                    }
+                }));
+            }
+            for (auto& worker : workers) {
+                worker.join();
+            }
+            double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            for (int32_t t = 1; t < threads; t++) {
+                stats[0].add(stats[t]);
+            }
+            double rate = stats[0].pairs_trained / secs;
+            if (threads == 1) {
+                single_thread_rate = rate;
+            }
+            std::cout << policy << ", " << threads << " threads: " << rate / 1e6 << "M pairs/sec ("
+                      << rate / single_thread_rate << "x), nodes contended " << stats[0].nodes_contended
+                      << ", skipped " << stats[0].nodes_skipped << std::endl;
+        }
+    }
+    return 0;
+}
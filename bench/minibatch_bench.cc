@@ -0,0 +1,84 @@
+/*
+ * Compare the throughput (pairs trained per second, on one core) of training
+ * a pair at a time with that of the minibatch engine, which trains all the
+ * context words of a window at once against shared negatives.  Random word
+ * ids are used, so no corpus is needed.
+ *
+ * Usage: minibatch_bench [dimension] [window size] [negatives] [windows]
+ */
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "args.h"
+#include "model.h"
+#include "random.h"
+#include "vector.h"
+
+using namespace minkowski;
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    auto args = std::make_shared<Args>();
+    args->dimension = argc > 1 ? std::stoi(argv[1]) : 100;
+    args->window_size = argc > 2 ? std::stoi(argv[2]) : 5;
+    args->number_negatives = argc > 3 ? std::stoi(argv[3]) : 10;
+    int64_t windows = argc > 4 ? std::stoll(argv[4]) : 200000;
+    const int32_t vocab_size = 100000;
+
+    Rng rng(1);
+    auto vectors = std::make_shared<std::vector<Vector>>();
+    Vector init_vector(args->dimension);
+    for (int32_t i = 0; i < vocab_size; i++) {
+        random_hyperboloid_point(init_vector, rng, 0.1);
+        vectors->push_back(init_vector);
+    }
+    Model model(vectors, args);
+    int32_t contexts = 2 * args->window_size;
+    int32_t negatives = args->number_negatives;
+
+    // a pair at a time: each of the 2 * window_size pairs has its own negatives
+    std::vector<int32_t> samples;
+    auto start = std::chrono::steady_clock::now();
+    for (int64_t w = 0; w < windows; w++) {
+        int32_t center = rng.below(vocab_size);
+        for (int32_t c = 0; c < contexts; c++) {
+            samples.clear();
+            samples.push_back(center);
+            for (int32_t n = 0; n < negatives; n++) {
+                samples.push_back(rng.below(vocab_size));
+            }
+            model.log_bilinear_negative_sampling(rng.below(vocab_size), samples, 0.01);
+        }
+    }
+    double pair_secs = seconds_since(start);
+
+    // a window at a time
+    std::vector<int32_t> inputs, outputs;
+    start = std::chrono::steady_clock::now();
+    for (int64_t w = 0; w < windows; w++) {
+        inputs.clear();
+        outputs.clear();
+        for (int32_t c = 0; c < contexts; c++) {
+            inputs.push_back(rng.below(vocab_size));
+        }
+        for (int32_t n = 0; n <= negatives; n++) {
+            outputs.push_back(rng.below(vocab_size));
+        }
+        model.minibatch_negative_sampling(inputs, outputs, 0.01);
+    }
+    double minibatch_secs = seconds_since(start);
+
+    int64_t pairs = windows * contexts;
+    std::cout << "dimension " << args->dimension << ", " << contexts << " context words, "
+              << negatives << " negatives\n";
+    std::cout << "pair:      " << pairs / pair_secs / 1e6 << "M pairs/sec\n";
+    std::cout << "minibatch: " << pairs / minibatch_secs / 1e6 << "M pairs/sec ("
+              << pair_secs / minibatch_secs << "x)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,78 @@
+/*
+ * Compare the alias table negative sampler against the unigram table it
+ * replaced: construction time, memory and sampling throughput, for a
+ * Zipfian vocabulary.
+ *
+ * Usage: negative_sampling_bench [vocabulary size] [number of draws]
+ */
+#include <math.h>
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "alias_table.h"
+#include "random.h"
+
+using namespace minkowski;
+
+static const int32_t NEGATIVE_TABLE_SIZE = 100000000;
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    int32_t vocab_size = argc > 1 ? std::stoi(argv[1]) : 1000000;
+    int64_t draws = argc > 2 ? std::stoll(argv[2]) : 100000000;
+    real power = 0.5;
+
+    std::vector<real> weights(vocab_size);
+    real z = 0.;
+    for (int32_t i = 0; i < vocab_size; i++) {
+        weights[i] = pow(1e9 / (i + 1), power);
+        z += weights[i];
+    }
+
+    // the previous implementation: materialise the distribution in a table
+    auto start = std::chrono::steady_clock::now();
+    std::vector<int32_t> negatives;
+    for (int32_t i = 0; i < vocab_size; i++) {
+        for (size_t j = 0; j < weights[i] * NEGATIVE_TABLE_SIZE / z; j++) {
+            negatives.push_back(i);
+        }
+    }
+    double table_build = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    AliasTable alias(weights);
+    double alias_build = seconds_since(start);
+
+    // the table was sampled with the standard library's generator
+    std::minstd_rand table_rng(1);
+    int64_t checksum = 0;
+    start = std::chrono::steady_clock::now();
+    for (int64_t i = 0; i < draws; i++) {
+        checksum += negatives[table_rng() % negatives.size()];
+    }
+    double table_sample = seconds_since(start);
+
+    Rng rng(1);
+    start = std::chrono::steady_clock::now();
+    for (int64_t i = 0; i < draws; i++) {
+        checksum += alias.sample(rng);
+    }
+    double alias_sample = seconds_since(start);
+
+    std::cout << "vocabulary size: " << vocab_size << ", draws: " << draws << "\n";
+    std::cout << "unigram table: " << negatives.capacity() * sizeof(int32_t) / double(1 << 20) << " MB, "
+              << "built in " << table_build << "s, "
+              << draws / table_sample / 1e6 << "M samples/sec\n";
+    std::cout << "alias table:   " << vocab_size * (sizeof(uint32_t) + sizeof(int32_t)) / double(1 << 20) << " MB, "
+              << "built in " << alias_build << "s, "
+              << draws / alias_sample / 1e6 << "M samples/sec\n";
+    std::cout << "(checksum " << checksum << ")" << std::endl;
+    return 0;
+}
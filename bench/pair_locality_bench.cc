@@ -0,0 +1,161 @@
+/*
+ * Compare the cache misses per pair (and the throughput, on one core) of
+ * training the skip-gram pairs in corpus order with those of -pair-buffer,
+ * which groups the pairs by source word and visits the rows in ascending
+ * order of word id.  The corpus is synthetic: lines of word ids drawn from a
+ * Zipf distribution, the ids sorted by decreasing frequency as in the
+ * dictionary.  The misses are counted with perf_event_open, where available.
+ *
+ * Usage: pair_locality_bench [vocab size] [dimension] [lines] [pair buffer]
+ */
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <string.h>
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "args.h"
+#include "minkowski.h"
+#include "model.h"
+#include "random.h"
+#include "vector.h"
+
+using namespace minkowski;
+
+/*
+ * A hardware cache event of the calling thread, if it can be counted.
+ */
+class CacheCounter {
+    int fd_;
+
+public:
+    CacheCounter(uint32_t type, uint64_t config) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd_ = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+    ~CacheCounter() {
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+    }
+    bool available() const { return fd_ >= 0; }
+    void start() {
+        if (fd_ >= 0) {
+            ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+    int64_t stop() {
+        int64_t count = 0;
+        if (fd_ >= 0) {
+            ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(fd_, &count, sizeof(count)) != sizeof(count)) {
+                count = 0;
+            }
+        }
+        return count;
+    }
+};
+
+/*
+ * Exposes the setup of the vectors and of the negative sampling without a
+ * dictionary.
+ */
+class LocalityBench : public Minkowski {
+public:
+    LocalityBench(std::shared_ptr<Args> args, const std::vector<int64_t>& counts) : Minkowski(args) {
+        Rng rng(args->seed);
+        Vector init_vector(args->dimension);
+        vectors_ = std::make_shared<std::vector<Vector>>();
+        for (size_t i = 0; i < counts.size(); i++) {
+            random_hyperboloid_point(init_vector, rng, args->init_std_dev);
+            vectors_->push_back(init_vector);
+        }
+        vector_flags_ = std::shared_ptr<std::vector<std::mutex>>(new std::vector<std::mutex>(vectors_->size()));
+        generate_negative_samples(counts);
+        create_replicas();
+    }
+
+    LockStats run(const std::vector<std::vector<int32_t>>& lines) {
+        Rng rng(args_->seed);
+        Model model(vectors_, args_);
+        LockStats stats;
+        for (auto& line : lines) {
+            if (args_->pair_buffer > 0) {
+                skipgram_buffered(model, replicas_[0], 0.01, line, 0, line.size(), rng, stats);
+            } else {
+                skipgram(model, replicas_[0], 0.01, line, 0, line.size(), rng, stats);
+            }
+        }
+        return stats;
+    }
+};
+
+int main(int argc, char** argv) {
+    const int32_t vocab_size = argc > 1 ? std::stoi(argv[1]) : 100000;
+    auto args = std::make_shared<Args>();
+    args->dimension = argc > 2 ? std::stoi(argv[2]) : 100;
+    int32_t num_lines = argc > 3 ? std::stoi(argv[3]) : 300;
+    int32_t pair_buffer = argc > 4 ? std::stoi(argv[4]) : 1000;
+    const int32_t line_length = 1000;
+
+    std::vector<int64_t> counts(vocab_size);
+    std::vector<real> zipf(vocab_size);
+    for (int32_t i = 0; i < vocab_size; i++) {
+        counts[i] = 1 + 100000000 / (i + 1);
+        zipf[i] = counts[i];
+    }
+    AliasTable corpus_distribution(zipf);
+    Rng rng(2);
+    std::vector<std::vector<int32_t>> lines(num_lines);
+    for (auto& line : lines) {
+        for (int32_t i = 0; i < line_length; i++) {
+            line.push_back(corpus_distribution.sample(rng));
+        }
+    }
+
+    CacheCounter l1_misses(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                           (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+    CacheCounter llc_misses(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    std::cout << "vocab " << vocab_size << ", dimension " << args->dimension << ", "
+              << args->number_negatives << " negatives, window " << args->window_size << "\n";
+    if (!l1_misses.available() || !llc_misses.available()) {
+        std::cout << "(cache misses can not be counted here: perf_event_open failed)\n";
+    }
+    double baseline_secs = 0;
+    for (int32_t buffer : {0, pair_buffer}) {
+        args->pair_buffer = buffer;
+        LocalityBench bench(args, counts);
+        l1_misses.start();
+        llc_misses.start();
+        auto start = std::chrono::steady_clock::now();
+        LockStats stats = bench.run(lines);
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double l1 = l1_misses.stop();
+        double llc = llc_misses.stop();
+        if (buffer == 0) {
+            baseline_secs = secs;
+        }
+        double pairs = stats.pairs_trained;
+        std::cout << (buffer == 0 ? "corpus order:    " : "pair buffer " + std::to_string(buffer) + ": ")
+                  << pairs / secs / 1e6 << "M pairs/sec (" << baseline_secs / secs << "x)";
+        if (l1_misses.available() && llc_misses.available()) {
+            std::cout << ", L1d misses/pair " << l1 / pairs << ", LLC misses/pair " << llc / pairs;
+        }
+        std::cout << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,166 @@
+/*
+ * Measure how much -lock-policy scheduled can train in parallel.  First, for
+ * one round of a synthetic corpus (word ids drawn from a Zipf distribution,
+ * the most frequent first, as the dictionary numbers them), the parallelism
+ * of the schedule: the number of pairs over the number of steps that the
+ * threads take to apply them, each applying its own pairs in turn and
+ * waiting for those that precede them on one of their rows.  This bounds the
+ * speedup over one thread.  "tracked" orders every row of a pair, as the
+ * schedule did before the most frequent rows were read from a snapshot as
+ * negatives; "shared" leaves those out.
+ * Second, the wall-clock time of training on the same corpus with 1 to
+ * `max threads` threads; speedups are only meaningful on as many cores as
+ * threads.
+ *
+ * Usage: schedule_parallelism_bench [vocab size] [lines] [max threads]
+ */
+#include <math.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "alias_table.h"
+#include "args.h"
+#include "minkowski.h"
+#include "random.h"
+
+using namespace minkowski;
+
+// as in minkowski.cc
+static const int32_t ROUND_TOKENS = 10000;
+static const int32_t SHARED_ROWS = 64;
+
+/*
+ * Return the number of pairs of a round of `threads` threads over the number
+ * of steps it takes, with the negatives below `shared` left out of the
+ * dependencies.
+ */
+double parallelism(const std::vector<std::vector<int32_t>>& streams, int32_t threads, int32_t vocab_size,
+                   int32_t window, int32_t num_negatives, AliasTable& negatives, int32_t shared) {
+    // the pairs of each thread, as the rows they update
+    std::vector<std::vector<std::vector<int32_t>>> pairs(threads);
+    Rng rng(1);
+    for (int32_t t = 0; t < threads; t++) {
+        auto& stream = streams[t];
+        for (int32_t w = 0; w < stream.size(); w++) {
+            for (int32_t c = -window; c <= window; c++) {
+                if (c == 0 || w + c < 0 || w + c >= stream.size() || stream[w] == stream[w + c]) {
+                    continue;
+                }
+                std::vector<int32_t> rows = {stream[w], stream[w + c]};
+                for (int32_t n = 0; n < num_negatives; n++) {
+                    int32_t negative = negatives.sample(rng);
+                    if (negative >= shared) {
+                        rows.push_back(negative);
+                    }
+                }
+                pairs[t].push_back(rows);
+            }
+        }
+    }
+    // interleaved, as the schedule orders them; a pair is applied a step
+    // after the last of the preceding pair of its thread and of its rows
+    std::vector<int64_t> step_of_row(vocab_size, 0), step_of_thread(threads, 0);
+    int64_t total = 0, steps = 0;
+    for (size_t k = 0;; k++) {
+        bool any = false;
+        for (int32_t t = 0; t < threads; t++) {
+            if (k >= pairs[t].size()) {
+                continue;
+            }
+            any = true;
+            int64_t step = step_of_thread[t];
+            for (auto row : pairs[t][k]) {
+                step = std::max(step, step_of_row[row]);
+            }
+            step++;
+            for (auto row : pairs[t][k]) {
+                step_of_row[row] = step;
+            }
+            step_of_thread[t] = step;
+            steps = std::max(steps, step);
+            total++;
+        }
+        if (!any) {
+            break;
+        }
+    }
+    return double(total) / steps;
+}
+
+int main(int argc, char** argv) {
+    const int32_t vocab_size = argc > 1 ? std::stoi(argv[1]) : 30000;
+    const int32_t num_lines = argc > 2 ? std::stoi(argv[2]) : 2000;
+    const int32_t max_threads = argc > 3 ? std::stoi(argv[3]) : 8;
+    const int32_t line_length = 100;
+    auto args = std::make_shared<Args>();
+
+    std::vector<real> zipf(vocab_size), weights(vocab_size);
+    for (int32_t i = 0; i < vocab_size; i++) {
+        zipf[i] = 1e8 / (i + 1);
+        weights[i] = pow(zipf[i], args->distribution_power);
+    }
+    AliasTable corpus_distribution(zipf);
+    AliasTable negatives(weights);
+    Rng rng(2);
+
+    std::cout << "vocab " << vocab_size << ", window " << args->window_size << ", negatives "
+              << args->number_negatives << ", " << std::thread::hardware_concurrency() << " cores\n";
+    std::vector<std::vector<int32_t>> streams(max_threads);
+    for (auto& stream : streams) {
+        for (int32_t i = 0; i < ROUND_TOKENS; i++) {
+            stream.push_back(corpus_distribution.sample(rng));
+        }
+    }
+    for (int32_t threads = 1; threads <= max_threads; threads *= 2) {
+        // the window is shrunk at random in training; take its mean
+        int32_t window = (args->window_size + 1) / 2;
+        double tracked = parallelism(streams, threads, vocab_size, window, args->number_negatives, negatives, 0);
+        double shared = parallelism(streams, threads, vocab_size, window, args->number_negatives, negatives,
+                                    SHARED_ROWS);
+        std::cout << threads << " threads: parallelism of a round " << tracked << " tracked, " << shared
+                  << " shared" << std::endl;
+    }
+
+    // the same corpus, as text, the most frequent words first
+    std::string input = "/tmp/schedule-parallelism-bench-" + std::to_string(getpid());
+    {
+        std::ofstream out(input);
+        for (int32_t l = 0; l < num_lines; l++) {
+            for (int32_t i = 0; i < line_length; i++) {
+                out << (i ? " " : "") << "w" << corpus_distribution.sample(rng);
+            }
+            out << "\n";
+        }
+    }
+    double single_thread_secs = 0;
+    for (int32_t threads = 1; threads <= max_threads; threads *= 2) {
+        args = std::make_shared<Args>();
+        args->input = input;
+        args->output = input + "-vectors";
+        args->dimension = 20;
+        args->epochs = 1;
+        args->min_count = 1;
+        args->threads = threads;
+        args->lock_policy = lock_policy_name::scheduled;
+        Minkowski minkowski(args);
+        auto start = std::chrono::steady_clock::now();
+        minkowski.train();
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (threads == 1) {
+            single_thread_secs = secs;
+        }
+        std::cout << threads << " threads: " << secs << " secs (" << single_thread_secs / secs << "x)"
+                  << std::endl;
+    }
+    std::remove(input.c_str());
+    return 0;
+}
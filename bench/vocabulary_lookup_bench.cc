@@ -0,0 +1,96 @@
+/*
+ * Compare the throughput of Dictionary::get_chunk (tokens/sec, on one core)
+ * with the frozen table, built once the vocabulary is complete, against that
+ * with the lookup of the growable table (byte-at-a-time FNV hashing and a
+ * string compare in words_ on each probe).  The corpus is synthetic and held
+ * in memory: lines of words of 2-14 characters drawn from a Zipf
+ * distribution, so that reading the corpus costs the same in both cases.
+ *
+ * Usage: vocabulary_lookup_bench [vocab size] [million tokens]
+ */
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "alias_table.h"
+#include "args.h"
+#include "dictionary.h"
+#include "random.h"
+#include "utils.h"
+
+using namespace minkowski;
+
+/*
+ * Exposes the lookup without the frozen table.
+ */
+class ThawedDictionary : public Dictionary {
+public:
+    explicit ThawedDictionary(std::shared_ptr<Args> args) : Dictionary(args) {}
+
+    void thaw() {
+        frozen_slots_.clear();
+    }
+};
+
+int main(int argc, char** argv) {
+    const int32_t vocab_size = argc > 1 ? std::stoi(argv[1]) : 1000000;
+    const int64_t num_tokens = int64_t(argc > 2 ? std::stod(argv[2]) : 20.) * 1000000;
+    const int32_t line_length = 1000;
+
+    Rng rng(5);
+    std::vector<std::string> words(vocab_size);
+    std::vector<real> zipf(vocab_size);
+    const std::string letters = "abcdefghijklmnopqrstuvwxyz";
+    for (int32_t i = 0; i < vocab_size; i++) {
+        int32_t length = 2 + rng.below(13);
+        for (int32_t c = 0; c < length; c++) {
+            words[i] += letters[rng.below(letters.size())];
+        }
+        words[i] += std::to_string(i); // distinct
+        zipf[i] = 1. / (i + 1);
+    }
+    AliasTable distribution(zipf);
+    std::string corpus;
+    for (int64_t t = 0; t < num_tokens; t++) {
+        corpus += words[distribution.sample(rng)];
+        corpus += (t + 1) % line_length == 0 ? '\n' : ' ';
+    }
+
+    auto args = std::make_shared<Args>();
+    args->min_count = 1;
+    args->t = 0; // no subsampling, so that every token is looked up and kept
+    args->threads = 1;
+    ThawedDictionary dict(args);
+    dict.determine_vocabulary(corpus.data(), corpus.data() + corpus.size());
+    std::cout << "vocab " << dict.nwords_ << ", " << dict.ntokens_ / 1000000 << "M tokens, "
+              << corpus.size() / 1000000 << " MB\n";
+
+    double frozen_secs = 0;
+    for (bool frozen : {true, false}) {
+        if (!frozen) {
+            dict.thaw();
+        }
+        utils::MemoryStream in(corpus.data(), corpus.data() + corpus.size());
+        Philox subsampling_rng(1, 0);
+        LinePosition position;
+        std::vector<int32_t> line;
+        int64_t tokens = 0, checksum = 0;
+        auto start = std::chrono::steady_clock::now();
+        while (in.peek() != EOF) {
+            tokens += dict.get_chunk(in, line, subsampling_rng, position);
+            for (int32_t w = position.begin; w < position.end; w++) {
+                checksum += line[w];
+            }
+        }
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (frozen) {
+            frozen_secs = secs;
+        }
+        std::cout << (frozen ? "frozen table:    " : "growable table:  ")
+                  << tokens / secs / 1e6 << "M tokens/sec (" << secs / frozen_secs << "x the time), checksum "
+                  << checksum << std::endl;
+    }
+    return 0;
+}
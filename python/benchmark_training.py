@@ -0,0 +1,135 @@
+# coding: utf-8
+"""
+Benchmarks the training throughput of minkowski under different training
+configurations, on the same corpus and with otherwise identical
+hyperparameters.  For each configuration, the wall-clock time, the throughput
+(tokens per second, over all threads) and the final training objective are
+printed.
+"""
+import re
+import subprocess
+import time
+
+INPUT_FILE = '/home/ubuntu/data/wikipedia.txt'
+MINKOWSKI_BINARY = '/home/ubuntu/minkowski-build/minkowski'
+OUTPUT_PREFIX = '/tmp/minkowski-benchmark'
+
+COMMON_ARGS = ['-dimension', '51', '-epochs', '1', '-min-count', '15',
+               '-t', '1e-5', '-window-size', '10', '-number-negatives', '10',
+               '-start-lr', '0.05', '-end-lr', '0']
+
+THREAD_COUNTS = [1, 2, 4, 8, 16, 32, 64]
+
+
+def run_training(extra_args):
+    """
+    Train a model with the provided command line arguments (in addition to
+    COMMON_ARGS). Returns the wall-clock time in seconds, the throughput in
+    tokens per second and the final value of the objective.
+    """
+    args = [MINKOWSKI_BINARY, '-input', INPUT_FILE, '-output', OUTPUT_PREFIX]
+    start = time.time()
+    result = subprocess.run(args + COMMON_ARGS + extra_args,
+                            stderr=subprocess.PIPE, universal_newlines=True,
+                            check=True)
+    seconds = time.time() - start
+
+    # the progress lines are separated by carriage returns
+    progress = [line for line in re.split('[\r\n]', result.stderr)
+                if line.startswith('Progress:')]
+    final = progress[-1]
+    words_per_thread = float(re.search(r'words/sec/thread:\s+(\S+)', final).group(1))
+    objective = float(re.search(r'objective:\s+(\S+)', final).group(1))
+    threads = int(extra_args[extra_args.index('-threads') + 1])
+    return seconds, words_per_thread * threads, objective
+
+
+def benchmark(label, configurations):
+    """
+    Run and report on each of the provided lists of extra arguments.
+    """
+    print('\n{}'.format(label))
+    print('{:<50} {:>10} {:>14} {:>10}'.format('arguments', 'seconds',
+                                                'tokens/sec', 'objective'))
+    for extra_args in configurations:
+        seconds, throughput, objective = run_training(extra_args)
+        print('{:<50} {:>10.1f} {:>14.0f} {:>10.4f}'.format(
+            ' '.join(extra_args), seconds, throughput, objective))
+
+
+def replica_scaling_curve(replica_counts=(2, 4)):
+    """
+    Compare the scaling of the shared-lock mode with that of local SGD with
+    the given numbers of replicas.
+    """
+    configurations = []
+    for threads in THREAD_COUNTS:
+        configurations.append(['-threads', str(threads)])
+        for replicas in replica_counts:
+            if replicas <= threads:
+                configurations.append(['-threads', str(threads),
+                                       '-replicas', str(replicas)])
+    benchmark('Scaling: shared-lock vs. replicas', configurations)
+
+
+def compare_engines(threads=64):
+    """
+    Compare training a pair at a time with the minibatch engine.
+    """
+    benchmark('Engines', [['-threads', str(threads), '-engine', engine]
+                          for engine in ['pair', 'minibatch']])
+
+
+def benchmark_quality(label, configurations):
+    """
+    As for benchmark, but reporting the quality of the vectors (the average
+    Spearman rank correlation over the similarity datasets, see
+    evaluate_similarity.py) in place of the objective.
+    """
+    from evaluate_similarity import evaluate_similarity
+    import numpy as np
+    print('\n{}'.format(label))
+    print('{:<50} {:>10} {:>14} {:>10}'.format('arguments', 'seconds',
+                                                'tokens/sec', 'similarity'))
+    for extra_args in configurations:
+        seconds, throughput, _ = run_training(extra_args)
+        rhos, weights = evaluate_similarity(OUTPUT_PREFIX + '.csv')
+        print('{:<50} {:>10.1f} {:>14.0f} {:>10.4f}'.format(
+            ' '.join(extra_args), seconds, throughput,
+            np.average(rhos, weights=weights)))
+
+
+def compare_models(threads=64):
+    """
+    Compare the throughput and the quality of skip-gram and CBOW.
+    """
+    benchmark_quality('Models', [['-threads', str(threads), '-model', model]
+                                 for model in ['skipgram', 'cbow']])
+
+
+def compare_losses(threads=64, negative_counts=(5, 10, 15, 25)):
+    """
+    Compare the hierarchical softmax with negative sampling, over numbers of
+    negatives, so that their throughput can be compared at equal quality.
+    """
+    configurations = [['-threads', str(threads), '-loss', 'hs']]
+    for negatives in negative_counts:
+        configurations.append(['-threads', str(threads), '-loss', 'ns',
+                               '-number-negatives', str(negatives)])
+    benchmark_quality('Losses', configurations)
+
+
+def compare_pair_buffers(threads=64):
+    """
+    Compare training the pairs in corpus order with grouping them by source.
+    """
+    benchmark('Pair buffer', [['-threads', str(threads), '-pair-buffer', str(size)]
+                              for size in [0, 100, 1000]])
+
+
+if __name__ == '__main__':
+    replica_scaling_curve()
+    compare_engines()
+    compare_pair_buffers()
+    compare_models()
+    compare_losses()
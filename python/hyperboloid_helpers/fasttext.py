@@ -1,3 +1,4 @@
+import numpy as np
 import pandas as pd
 
 
@@ -13,10 +14,46 @@ def load_fasttext_vectors(fname):
     return syn0
 
 
+# the header of a vector file, as written with -output-format bin
+VECTOR_FILE_HEADER = np.dtype([('magic', '=i4'), ('version', '=i4'), ('count', '=i8'),
+                               ('dimension', '=i8'), ('dtype', '=i4'), ('model', '=i4'),
+                               ('loss', '=i4'), ('reserved', '=i4'), ('strings_offset', '=i8'),
+                               ('matrix_offset', '=i8'), ('file_size', '=i8')])
+VECTOR_FILE_MAGIC = 0x4d4b5643
+VECTOR_FILE_DTYPES = {1: np.dtype('=f8'), 2: np.dtype('=f4')}
+
+
+def load_minkowski_matrix(fname):
+    """
+    Maps a minkowski vector file (.bin) into memory, returns the list of words
+    and the read-only matrix of their vectors, row by row.
+    """
+    header = np.fromfile(fname, dtype=VECTOR_FILE_HEADER, count=1)
+    if len(header) == 0 or header[0]['magic'] != VECTOR_FILE_MAGIC or header[0]['version'] != 1:
+        raise ValueError('{} is not a vector file'.format(fname))
+    header = header[0]
+    count, dimension = int(header['count']), int(header['dimension'])
+    if count == 0:
+        return [], np.zeros((0, dimension), dtype=VECTOR_FILE_DTYPES[int(header['dtype'])])
+    ends = np.memmap(fname, dtype='=i8', mode='r', offset=int(header['strings_offset']), shape=(count,))
+    chars = np.memmap(fname, dtype=np.uint8, mode='r',
+                      offset=int(header['strings_offset']) + 8 * count, shape=(int(ends[-1]),))
+    chars = chars.tobytes()
+    starts = np.concatenate(([0], ends[:-1]))
+    words = [chars[start:end].decode('utf-8') for start, end in zip(starts, ends)]
+    matrix = np.memmap(fname, dtype=VECTOR_FILE_DTYPES[int(header['dtype'])], mode='r',
+                       offset=int(header['matrix_offset']), shape=(count, dimension))
+    return words, matrix
+
+
 def load_minkowski_vectors(fname):
     """
-    Loads a minkowski word vectors text file, returns DataFrame.
+    Loads a minkowski word vectors text file, or vector file (.bin), returns
+    DataFrame.
     """
+    if fname.endswith('.bin'):
+        words, matrix = load_minkowski_matrix(fname)
+        return pd.DataFrame(matrix, index=words, columns=range(1, matrix.shape[1] + 1))
     syn0 = pd.read_csv(fname, header=None, sep=' ',
                        na_values=None, keep_default_na=False # these two are needed since otherwise Pandas maps "null" and "nan" to np.nan!
                        ).set_index(0)
@@ -16,24 +16,47 @@ NEG = 10
 INIT_STDDEV = 0.01
 
 
-def run_training(dim, epochs, lr, t, ws, min_count, neg, init_stddev):
+def hyperbolic_output_file(dim, epochs, lr, t, ws, min_count, neg,
+                           init_stddev):
+    return 'vecs-{}-hyperbolic-dim-{}-epochs-{}-lr-{}-t-{}' \
+           '-ws-{}-minCount-{}-neg-{}-initStddev-{}'.format(
+        INPUT_LABEL, dim, epochs, lr, t, ws, min_count, neg, init_stddev)
+
+
+def run_hyperbolic_sweep(learning_rates, dimensions, epochs, t, ws, min_count,
+                         neg, init_stddev):
     """
-    Train a hyperbolic and a Euclidean skip-gram model given the provided
-    hyperparameters. Returns the file names where the resulting embeddings
-    were stored.
+    Train a hyperbolic skip-gram model for each combination of learning rate
+    and dimension with a single `minkowski sweep`, which counts the vocabulary
+    and reads the corpus once for all of them. Returns the file names where
+    the resulting embeddings were stored.
     """
+    prefix = 'vecs-{}-hyperbolic-sweep'.format(INPUT_LABEL)
+    os.system('/home/ubuntu/minkowski-build/minkowski sweep -input {} '
+              '-output {} -max-step-size 1.0 -sweep-dimension {} -sweep-lr {} '
+              '-start-lr {} -end-lr 0 -epochs {} -init-std-dev {} '
+              '-min-count {} -t {} -window-size {} -number-negatives {} '
+              '-threads 64'.format(
+        INPUT_FILE, prefix, ','.join(str(dim + 1) for dim in dimensions),
+        ','.join(str(lr) for lr in learning_rates), learning_rates[0], epochs,
+        init_stddev, min_count, t, ws, neg))
+
+    files = []
+    for lr, dim in product(learning_rates, dimensions):
+        output_file = hyperbolic_output_file(dim, epochs, lr, t, ws,
+                                             min_count, neg, init_stddev)
+        os.rename('{}-dim-{}-lr-{}.csv'.format(prefix, dim + 1, lr),
+                  output_file + '.csv')
+        files.append(output_file + '.csv')
+    return files
 
-    output_file_hyperbolic = 'vecs-{}-hyperbolic-dim-{}-epochs-{}-lr-{}-t-{}' \
-                             '-ws-{}-minCount-{}-neg-{}-initStddev-{}'.format(
-        INPUT_LABEL, dim, epochs, lr, t, ws, min_count, neg, init_stddev)
-
-    os.system('/home/ubuntu/minkowski-build/minkowski -input {} -output {} '
-              '-max-step-size 1.0 -dimension {} -start-lr {} -end-lr 0 '
-              '-epochs {} -init-std-dev {} -min-count {} -t {} -window-size {} '
-              '-number-negatives {} -threads 64'.format(
-        INPUT_FILE, output_file_hyperbolic, dim + 1, lr, epochs, init_stddev,
-        min_count, t, ws, neg))
 
+def run_euclidean_training(dim, epochs, lr, t, ws, min_count, neg):
+    """
+    Train a Euclidean skip-gram model with fastText given the provided
+    hyperparameters. Returns the file name where the resulting embeddings
+    were stored.
+    """
     output_file_euclidean = 'vecs-{}-euclidean-dim-{}-epochs-{}-lr-{}-t-{}' \
                             '-ws-{}-minCount-{}-neg-{}'.format(
         INPUT_LABEL, dim, epochs, lr, t, ws, min_count, neg)
@@ -44,7 +67,7 @@ def run_training(dim, epochs, lr, t, ws, min_count, neg, init_stddev):
         INPUT_FILE, output_file_euclidean, dim, lr, epochs, min_count, t, ws,
         neg))
 
-    return output_file_hyperbolic + '.csv', output_file_euclidean + '.vec'
+    return output_file_euclidean + '.vec'
 
 
 def sweep_lr_and_dimension(learning_rates, dimensions):
@@ -57,14 +80,19 @@ def sweep_lr_and_dimension(learning_rates, dimensions):
     hyperbolic_files = []
     euclidean_files = []
 
+    try:
+        hyperbolic_files = run_hyperbolic_sweep(
+            learning_rates, dimensions, EPOCHS, T, WS, MIN_COUNT, NEG,
+            INIT_STDDEV)
+    except Exception as e:
+        print('Training failed: {}'.format(str(e)))
+
     for lr, dim in product(learning_rates, dimensions):
 
         print('\nLearning rate {}, dimension {}\n'.format(lr, dim))
         try:
-            h_file, e_file = run_training(dim, EPOCHS, lr, T, WS, MIN_COUNT,
-                                          NEG, INIT_STDDEV)
-            hyperbolic_files.append(h_file)
-            euclidean_files.append(e_file)
+            euclidean_files.append(run_euclidean_training(
+                dim, EPOCHS, lr, T, WS, MIN_COUNT, NEG))
         except Exception as e:
             print('Training failed: {}'.format(str(e)))
 
@@ -0,0 +1,73 @@
+#include "alias_table.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace minkowski {
+
+AliasTable::AliasTable(const std::vector<real>& weights) :
+    thresholds_(weights.size(), 0), aliases_(weights.size(), 0) {
+    int32_t n = weights.size();
+    real z = 0.;
+    for (int32_t i = 0; i < n; i++) {
+        z += weights[i];
+    }
+    if (n == 0 || z <= 0.) {
+        throw std::invalid_argument("Cannot build an alias table for an empty distribution.");
+    }
+    // scale the weights so that they average to 1, then partition the
+    // buckets into those that are under- and over-full (Vose's algorithm)
+    std::vector<real> scaled(n);
+    std::vector<real> probas(n, 1.);
+    std::vector<int32_t> small, large;
+    for (int32_t i = n - 1; i >= 0; i--) {
+        scaled[i] = weights[i] * n / z;
+        aliases_[i] = i;
+        if (scaled[i] < 1.) {
+            small.push_back(i);
+        } else {
+            large.push_back(i);
+        }
+    }
+    while (!small.empty() && !large.empty()) {
+        int32_t s = small.back();
+        int32_t l = large.back();
+        small.pop_back();
+        // the remainder of bucket s is filled up from l
+        probas[s] = scaled[s];
+        aliases_[s] = l;
+        scaled[l] -= 1. - scaled[s];
+        if (scaled[l] < 1.) {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+    // what remains is (up to rounding error) exactly full, so is its own
+    // alias and keeps probability 1
+    for (int32_t i = 0; i < n; i++) {
+        real threshold = std::round(probas[i] * 4294967296.);
+        thresholds_[i] = uint32_t(std::min(threshold, 4294967295.));
+    }
+}
+
+real AliasTable::probability(int32_t i) const {
+    int32_t n = thresholds_.size();
+    real proba = 0.;
+    for (int32_t j = 0; j < n; j++) {
+        real keep = aliases_[j] == j ? 1. : real(thresholds_[j]) / 4294967296.;
+        if (j == i) {
+            proba += keep;
+        }
+        if (aliases_[j] == i && j != i) {
+            proba += 1. - keep;
+        }
+    }
+    return proba / n;
+}
+
+int32_t AliasTable::size() const {
+    return thresholds_.size();
+}
+
+}
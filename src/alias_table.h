@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "random.h"
+#include "real.h"
+
+namespace minkowski {
+
+/*
+ * Walker's alias method for sampling from a fixed discrete distribution.
+ * Construction is O(n) and each draw is O(1): the high half of a single
+ * 64-bit random value chooses the bucket (by multiply-shift) and the low
+ * half is compared against the bucket's integer threshold.  The sampled
+ * probabilities are exactly those provided (up to floating point
+ * precision), unlike a materialised unigram table, which rounds each
+ * probability to a multiple of 1/table size.
+ */
+class AliasTable {
+protected:
+    // the bucket itself is returned iff the coin is below its threshold,
+    // i.e. with probability threshold / 2^32 (full buckets are their own alias)
+    std::vector<uint32_t> thresholds_;
+    std::vector<int32_t> aliases_;
+
+public:
+    /*
+     * Build the table for the distribution proportional to `weights`.
+     * Pre: all weights are non-negative and at least one is positive.
+     */
+    explicit AliasTable(const std::vector<real>& weights);
+
+    /*
+     * Return an index sampled from the distribution.
+     */
+    inline int32_t sample(Rng& rng) const {
+        uint64_t r = rng();
+        uint32_t bucket = uint32_t(((r >> 32) * thresholds_.size()) >> 32);
+        return uint32_t(r) < thresholds_[bucket] ? bucket : aliases_[bucket];
+    }
+
+    /*
+     * Return the probability with which `sample` returns the index `i`.
+     * This is reconstructed from the table, so O(n).
+     */
+    real probability(int32_t i) const;
+
+    /*
+     * Return the number of outcomes of the distribution.
+     */
+    int32_t size() const;
+};
+
+}
@@ -8,6 +8,7 @@
 namespace minkowski {
 
 Args::Args() {
+    command = "train";
     start_lr = 0.05;
     end_lr = 0.05;
     burnin_lr = 0.05;
@@ -15,6 +16,10 @@ Args::Args() {
     dimension = 100;
     window_size = 5;
     checkpoint_interval = -1;
+    checkpoint_tokens = 0;
+    checkpoint_seconds = 0;
+    checkpoint_deltas = 0;
+    state_tokens = 0;
     distribution_power = 0.5;
     epochs = 5;
     burnin_epochs = 0;
@@ -23,12 +28,80 @@ Args::Args() {
     threads = 12;
     t = 1e-4;
     init_std_dev = 0.1;
+    replay_fraction = 0.1;
+    grow_vocab = 0;
+    count_memory = 0;
+    verify_counts = 1;
     seed = 1;
+    input_format = input_format_name::text;
+    output_format = output_format_name::csv;
+    pair_weighting = pair_weighting_name::count;
+    model = model_name::skipgram;
+    loss = loss_name::ns;
+    lock_policy = lock_policy_name::skip;
+    engine = engine_name::pair;
+    pair_buffer = 0;
+    negative_retries = -1;
+    replicas = 1;
+    sync_interval = 1000000;
+    server_id = 0;
+    workers = 1;
+    worker_id = 0;
+    batch_tokens = 1000;
+}
+
+std::string Args::input_format_to_string(input_format_name format) const {
+    switch (format) {
+        case input_format_name::text:
+            return "text";
+        case input_format_name::pairs:
+            return "pairs";
+        case input_format_name::edges:
+            return "edges";
+    }
+    return "Unknown input format!"; // should never happen
+}
+
+std::string Args::output_format_to_string(output_format_name format) const {
+    switch (format) {
+        case output_format_name::csv:
+            return "csv";
+        case output_format_name::bin:
+            return "bin";
+        case output_format_name::both:
+            return "both";
+    }
+    return "Unknown output format!"; // should never happen
+}
+
+std::string Args::lock_policy_to_string(lock_policy_name lp) const {
+    switch (lp) {
+        case lock_policy_name::skip:
+            return "skip";
+        case lock_policy_name::sorted:
+            return "sorted";
+        case lock_policy_name::deferred:
+            return "deferred";
+        case lock_policy_name::scheduled:
+            return "scheduled";
+    }
+    return "Unknown lock policy!"; // should never happen
 }
 
 
 void Args::parse_args(const std::vector<std::string>& args) {
-    for (int ai = 1; ai < args.size(); ai += 2) {
+    int first = 1;
+    if (args.size() > 1 && args[1][0] != '-') {
+        command = args[1];
+        first = 2;
+        if (command != "train" && command != "sweep" && command != "pairs" &&
+                command != "server" && command != "worker" && command != "compact") {
+            std::cerr << "Unknown command: " << command << std::endl;
+            print_help();
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (int ai = first; ai < args.size(); ai += 2) {
         if (args[ai][0] != '-') {
             std::cerr << "Provided argument without a dash! Usage:" << std::endl;
             print_help();
@@ -43,6 +116,26 @@ void Args::parse_args(const std::vector<std::string>& args) {
                 input = std::string(args.at(ai + 1));
             } else if (args[ai] == "-output") {
                 output = std::string(args.at(ai + 1));
+            } else if (args[ai] == "-init-vectors") {
+                init_vectors = std::string(args.at(ai + 1));
+            } else if (args[ai] == "-save-vocab") {
+                save_vocab = std::string(args.at(ai + 1));
+            } else if (args[ai] == "-read-vocab") {
+                read_vocab = std::string(args.at(ai + 1));
+            } else if (args[ai] == "-grow-vocab") {
+                grow_vocab = std::stoi(args.at(ai + 1));
+            } else if (args[ai] == "-count-memory") {
+                count_memory = std::stoi(args.at(ai + 1));
+            } else if (args[ai] == "-verify-counts") {
+                verify_counts = std::stoi(args.at(ai + 1));
+            } else if (args[ai] == "-replay") {
+                replay = std::string(args.at(ai + 1));
+            } else if (args[ai] == "-replay-fraction") {
+                replay_fraction = std::stof(args.at(ai + 1));
+            } else if (args[ai] == "-sweep-lr") {
+                sweep_lr = std::string(args.at(ai + 1));
+            } else if (args[ai] == "-sweep-dimension") {
+                sweep_dimension = std::string(args.at(ai + 1));
             } else if (args[ai] == "-max-step-size") {
                 max_step_size = std::stof(args.at(ai + 1));
             } else if (args[ai] == "-start-lr") {
@@ -67,6 +160,16 @@ void Args::parse_args(const std::vector<std::string>& args) {
                 min_count = std::stoi(args.at(ai + 1));
             } else if (args[ai] == "-checkpoint-interval") {
                 checkpoint_interval = std::stoi(args.at(ai + 1));
+            } else if (args[ai] == "-checkpoint-tokens") {
+                checkpoint_tokens = std::stoll(args.at(ai + 1));
+            } else if (args[ai] == "-checkpoint-seconds") {
+                checkpoint_seconds = std::stoi(args.at(ai + 1));
+            } else if (args[ai] == "-checkpoint-deltas") {
+                checkpoint_deltas = std::stoi(args.at(ai + 1));
+            } else if (args[ai] == "-state-tokens") {
+                state_tokens = std::stoll(args.at(ai + 1));
+            } else if (args[ai] == "-resume") {
+                resume = std::string(args.at(ai + 1));
             } else if (args[ai] == "-number-negatives") {
                 number_negatives = std::stoi(args.at(ai + 1));
             } else if (args[ai] == "-threads") {
@@ -75,6 +178,109 @@ void Args::parse_args(const std::vector<std::string>& args) {
                 seed = std::stoi(args.at(ai + 1));
             } else if (args[ai] == "-t") {
                 t = std::stof(args.at(ai + 1));
+            } else if (args[ai] == "-lock-policy") {
+                std::string policy = args.at(ai + 1);
+                if (policy == "skip") {
+                    lock_policy = lock_policy_name::skip;
+                } else if (policy == "sorted") {
+                    lock_policy = lock_policy_name::sorted;
+                } else if (policy == "deferred") {
+                    lock_policy = lock_policy_name::deferred;
+                } else if (policy == "scheduled") {
+                    lock_policy = lock_policy_name::scheduled;
+                } else {
+                    std::cerr << "Unknown lock policy: " << policy << std::endl;
+                    print_help();
+                    exit(EXIT_FAILURE);
+                }
+            } else if (args[ai] == "-input-format") {
+                std::string name = args.at(ai + 1);
+                if (name == "text") {
+                    input_format = input_format_name::text;
+                } else if (name == "pairs") {
+                    input_format = input_format_name::pairs;
+                } else if (name == "edges") {
+                    input_format = input_format_name::edges;
+                } else {
+                    std::cerr << "Unknown input format: " << name << std::endl;
+                    print_help();
+                    exit(EXIT_FAILURE);
+                }
+            } else if (args[ai] == "-output-format") {
+                std::string name = args.at(ai + 1);
+                if (name == "csv") {
+                    output_format = output_format_name::csv;
+                } else if (name == "bin") {
+                    output_format = output_format_name::bin;
+                } else if (name == "both") {
+                    output_format = output_format_name::both;
+                } else {
+                    std::cerr << "Unknown output format: " << name << std::endl;
+                    print_help();
+                    exit(EXIT_FAILURE);
+                }
+            } else if (args[ai] == "-pair-weighting") {
+                std::string name = args.at(ai + 1);
+                if (name == "count") {
+                    pair_weighting = pair_weighting_name::count;
+                } else if (name == "ppmi") {
+                    pair_weighting = pair_weighting_name::ppmi;
+                } else {
+                    std::cerr << "Unknown pair weighting: " << name << std::endl;
+                    print_help();
+                    exit(EXIT_FAILURE);
+                }
+            } else if (args[ai] == "-model") {
+                std::string name = args.at(ai + 1);
+                if (name == "skipgram") {
+                    model = model_name::skipgram;
+                } else if (name == "cbow") {
+                    model = model_name::cbow;
+                } else {
+                    std::cerr << "Unknown model: " << name << std::endl;
+                    print_help();
+                    exit(EXIT_FAILURE);
+                }
+            } else if (args[ai] == "-loss") {
+                std::string name = args.at(ai + 1);
+                if (name == "ns") {
+                    loss = loss_name::ns;
+                } else if (name == "hs") {
+                    loss = loss_name::hs;
+                } else {
+                    std::cerr << "Unknown loss: " << name << std::endl;
+                    print_help();
+                    exit(EXIT_FAILURE);
+                }
+            } else if (args[ai] == "-engine") {
+                std::string name = args.at(ai + 1);
+                if (name == "pair") {
+                    engine = engine_name::pair;
+                } else if (name == "minibatch") {
+                    engine = engine_name::minibatch;
+                } else {
+                    std::cerr << "Unknown engine: " << name << std::endl;
+                    print_help();
+                    exit(EXIT_FAILURE);
+                }
+            } else if (args[ai] == "-pair-buffer") {
+                pair_buffer = std::stoi(args.at(ai + 1));
+            } else if (args[ai] == "-negative-retries") {
+                negative_retries = std::stoi(args.at(ai + 1));
+            } else if (args[ai] == "-replicas") {
+                replicas = std::stoi(args.at(ai + 1));
+            } else if (args[ai] == "-sync-interval") {
+                sync_interval = std::stoi(args.at(ai + 1));
+            } else if (args[ai] == "-servers") {
+                servers = std::string(args.at(ai + 1));
+            } else if (args[ai] == "-server-id") {
+                server_id = std::stoi(args.at(ai + 1));
+            } else if (args[ai] == "-workers") {
+                workers = std::stoi(args.at(ai + 1));
+            } else if (args[ai] == "-worker-id") {
+                worker_id = std::stoi(args.at(ai + 1));
+            } else if (args[ai] == "-batch-tokens") {
+                batch_tokens = std::stoi(args.at(ai + 1));
             } else {
                 std::cerr << "Unknown argument: " << args[ai] << std::endl;
                 print_help();
@@ -86,7 +292,13 @@ void Args::parse_args(const std::vector<std::string>& args) {
             exit(EXIT_FAILURE);
         }
     }
-    if (input.empty() || output.empty()) {
+    if (command == "server") {
+        if (servers.empty()) {
+            std::cerr << "Empty list of servers." << std::endl;
+            print_help();
+            exit(EXIT_FAILURE);
+        }
+    } else if (input.empty() || output.empty()) {
         std::cerr << "Empty input or output path." << std::endl;
         print_help();
         exit(EXIT_FAILURE);
@@ -95,8 +307,18 @@ void Args::parse_args(const std::vector<std::string>& args) {
 
 void Args::print_help() {
     std::cerr
+            << "usage: minkowski [train|sweep|pairs|server|worker|compact] <args>\n"
+            << "  train                   train on a single machine (the default)\n"
+            << "  sweep                   train a model for each -sweep-lr and -sweep-dimension, sharing the vocabulary\n"
+            << "  pairs                   aggregate the weighted pairs of -input into the pair file <output>.pairs\n"
+            << "  server                  serve a shard of the vectors to workers\n"
+            << "  worker                  train against the servers, on a share of the input\n"
+            << "  compact                 merge the delta checkpoint -input, and those it follows, into the vectors <output>.csv/.bin\n\n"
             << "  -input                  training file path\n"
             << "  -output                 output file path\n"
+            << "  -input-format           text, pairs (a pair file) or edges (an edge list, for pairs) [" << input_format_to_string(input_format) << "]\n"
+            << "  -output-format          csv, bin (a binary vector file, to be mapped into memory) or both [" << output_format_to_string(output_format) << "]\n"
+            << "  -pair-weighting         weight of a pair in the pair file: count or ppmi [" << (pair_weighting == pair_weighting_name::count ? "count" : "ppmi") << "]\n"
             << "  -min-count              minimal number of word occurences [" << min_count << "]\n"
             << "  -t                      sub-sampling threshold (0=don't subsample) [" << t << "]\n"
             << "  -start-lr               start learning rate [" << start_lr << "]\n"
@@ -105,14 +327,42 @@ void Args::print_help() {
             << "  -max-step-size          max. dist to travel in one update [" << max_step_size << "]\n"
             << "  -dimension              dimension of the Minkowski ambient [" << dimension << "]\n"
             << "  -window-size            size of the context window [" << window_size << "]\n"
+            << "  -init-vectors           start from the vectors of a previous run (a .csv or .bin output), for the words it has\n"
+            << "  -save-vocab             save the vocabulary, with the counts of all words seen (binary), to this file\n"
+            << "  -read-vocab             read the vocabulary saved by a previous run instead of counting -input\n"
+            << "  -grow-vocab             with -read-vocab, add the words of -input (new text) to it (1) or not (0) [" << grow_vocab << "]\n"
+            << "  -count-memory           count the vocabulary in a sketch of this many MB, exactly only for the words reaching -min-count (0=count all exactly) [" << count_memory << "]\n"
+            << "  -verify-counts          with -count-memory, recount the words reaching -min-count exactly (1) or keep their upper bounds (0) [" << verify_counts << "]\n"
+            << "  -replay                 a previous input, a sample of whose lines is trained along with -input\n"
+            << "  -replay-fraction        fraction of the lines of -replay that are trained [" << replay_fraction << "]\n"
+            << "  -sweep-lr               comma-separated start learning rates of the sweep command\n"
+            << "  -sweep-dimension        comma-separated dimensions of the sweep command\n"
             << "  -init-std-dev           stddev of the hyperbolic distance from the base point for initialization [" << init_std_dev << "]\n"
             << "  -burnin-epochs          number of extra prelim epochs with burn-in learning rate [" << burnin_epochs << "]\n"
             << "  -epochs                 number of epochs with learning rate linearly decreasing from -start-lr to -end-lr [" << epochs << "]\n"
             << "  -number-negatives       number of negatives sampled [" << number_negatives << "]\n"
             << "  -distribution-power     power used to modified distribution for negative sampling [" << distribution_power << "]\n"
             << "  -checkpoint-interval    save vectors every this many epochs [" << checkpoint_interval << "]\n"
+            << "  -checkpoint-tokens      also save vectors, in the background, every this many tokens trained (0=never) [" << checkpoint_tokens << "]\n"
+            << "  -checkpoint-seconds     also save vectors, in the background, every this many seconds (0=never) [" << checkpoint_seconds << "]\n"
+            << "  -checkpoint-deltas      write up to this many of those in a row as deltas of the rows changed since the previous checkpoint, then a full one (0=all full) [" << checkpoint_deltas << "]\n"
+            << "  -state-tokens           save the training state, to resume from, to <output>.state every this many tokens and after each epoch (0=never) [" << state_tokens << "]\n"
+            << "  -resume                 resume training from a state saved with -state-tokens (with the same options)\n"
             << "  -threads                number of threads [" << threads << "]\n"
+            << "  -model                  skipgram, or cbow (the centroid of the context predicts the word) [" << (model == model_name::skipgram ? "skipgram" : "cbow") << "]\n"
+            << "  -loss                   ns (negative sampling) or hs (hierarchical softmax, skipgram only) [" << (loss == loss_name::ns ? "ns" : "hs") << "]\n"
+            << "  -engine                 pair (a pair at a time) or minibatch (a window at a time, with shared negatives) [" << (engine == engine_name::pair ? "pair" : "minibatch") << "]\n"
+            << "  -pair-buffer            center words whose pairs are grouped by source word and trained together (0=in corpus order) [" << pair_buffer << "]\n"
+            << "  -lock-policy            acquisition of locks under contention: skip, sorted, deferred or scheduled (deterministic) [" << lock_policy_to_string(lock_policy) << "]\n"
+            << "  -negative-retries       max. redraws of locked or repeated negatives before training with fewer (-1=no limit) [" << negative_retries << "]\n"
+            << "  -replicas               number of copies of the vectors, each trained by a group of threads [" << replicas << "]\n"
+            << "  -sync-interval          merge the replicas every this many tokens [" << sync_interval << "]\n"
+            << "  -servers                comma-separated server addresses, tcp://<host>:<port> or unix://<path>\n"
+            << "  -server-id              index into -servers of this server [" << server_id << "]\n"
+            << "  -workers                number of worker processes [" << workers << "]\n"
+            << "  -worker-id              index of this worker, from 0 [" << worker_id << "]\n"
+            << "  -batch-tokens           tokens per batch of rows pulled from and pushed to the servers [" << batch_tokens << "]\n"
             << "  -seed                   seed for the random number generator [" << seed << "]\n"
-            << "                          n.b. only deterministic if single threaded!\n";
+            << "                          n.b. only deterministic if single threaded, or with -lock-policy scheduled!\n";
 }
 }
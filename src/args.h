@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <istream>
 #include <ostream>
 #include <string>
@@ -7,11 +8,83 @@
 
 namespace minkowski {
 
+/*
+ * How the locks on the vectors of a (source, target) pair and its negatives
+ * are acquired:
+ *  skip:     try to lock, skipping the pair if the source or target is taken
+ *  sorted:   wait for all locks, acquiring them in ascending order of word id
+ *  deferred: try to lock, and retry contended pairs with `sorted` at the end
+ *            of the line
+ *  scheduled: no locks: the pairs of all threads are put in a fixed order,
+ *            and the updates of each row applied in that order, so that
+ *            training is deterministic for a given -seed and -threads
+ */
+enum class lock_policy_name : int { skip = 1, sorted, deferred, scheduled };
+
+/*
+ * The format of -input:
+ *  text:  a corpus, one sentence or document per line
+ *  pairs: a pair file, as written by the pairs command
+ *  edges: an edge list, one "<source> <target> [weight]" per line (for the
+ *         pairs command only)
+ */
+enum class input_format_name : int { text = 1, pairs, edges };
+
+/*
+ * The format in which the vectors are saved:
+ *  csv:  <output>.csv, a line of a word and its coordinates per word
+ *  bin:  <output>.bin, a vector file (see vector_file.h), that can be
+ *        mapped into memory
+ *  both: both of the above
+ */
+enum class output_format_name : int { csv = 1, bin, both };
+
+/*
+ * How the pairs command weights the co-occurrences of two words:
+ *  count: by the number of co-occurrences within the window
+ *  ppmi:  by their positive pointwise mutual information
+ */
+enum class pair_weighting_name : int { count = 1, ppmi };
+
+/*
+ * What is trained to predict the words:
+ *  skipgram: each context word, separately
+ *  cbow:     the Lorentzian centroid of the context words
+ */
+enum class model_name : int { skipgram = 1, cbow };
+
+/*
+ * How the probability of a word is modelled:
+ *  ns: by negative sampling
+ *  hs: by the hierarchical softmax, as binary decisions along the path of
+ *      the word in the Huffman tree of the vocabulary
+ */
+enum class loss_name : int { ns = 1, hs };
+
+/*
+ * How the (source, target) pairs are trained:
+ *  pair:      one pair at a time, each with its own negative samples
+ *  minibatch: all context words of a center word at once, against the center
+ *             word and a single set of shared negative samples
+ */
+enum class engine_name : int { pair = 1, minibatch };
+
 class Args {
 public:
     Args();
+    std::string command;
     std::string input;
     std::string output;
+    std::string init_vectors;
+    std::string save_vocab;
+    std::string read_vocab;
+    int grow_vocab;
+    int count_memory;
+    int verify_counts;
+    std::string replay;
+    double replay_fraction;
+    std::string sweep_lr;
+    std::string sweep_dimension;
     double start_lr;
     double end_lr;
     double burnin_lr;
@@ -19,6 +92,11 @@ public:
     int seed;
     int dimension;
     int checkpoint_interval;
+    int64_t checkpoint_tokens;
+    int checkpoint_seconds;
+    int checkpoint_deltas;
+    int64_t state_tokens;
+    std::string resume;
     double distribution_power;
     int window_size;
     int epochs;
@@ -28,8 +106,27 @@ public:
     int threads;
     double t;
     double init_std_dev;
+    input_format_name input_format;
+    output_format_name output_format;
+    pair_weighting_name pair_weighting;
+    model_name model;
+    loss_name loss;
+    lock_policy_name lock_policy;
+    engine_name engine;
+    int pair_buffer;
+    int negative_retries;
+    int replicas;
+    int sync_interval;
+    std::string servers;
+    int server_id;
+    int workers;
+    int worker_id;
+    int batch_tokens;
 
     void parse_args(const std::vector<std::string>& args);
     void print_help();
+    std::string input_format_to_string(input_format_name) const;
+    std::string output_format_to_string(output_format_name) const;
+    std::string lock_policy_to_string(lock_policy_name) const;
 };
 }
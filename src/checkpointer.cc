@@ -0,0 +1,116 @@
+#include "checkpointer.h"
+
+#include <chrono>
+#include <iostream>
+
+namespace minkowski {
+
+typedef std::chrono::steady_clock Clock;
+
+static double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+Checkpointer::Checkpointer(std::shared_ptr<std::vector<Vector>> vectors,
+                           std::shared_ptr<std::vector<std::mutex>> flags,
+                           std::shared_ptr<std::vector<uint8_t>> dirty, int64_t rows, Writer writer) :
+    vectors_(vectors), flags_(flags), dirty_(dirty), writer_(writer),
+    snapshot_(rows, Vector(vectors->at(0).size())), changed_(rows, 0), copied_(false), delta_(false),
+    stopping_(false), taken_(0), dropped_(0), rows_copied_(0),
+    copy_seconds_(0.), write_seconds_(0.), stall_seconds_(0.) {
+    thread_ = std::thread([this]() { run(); });
+}
+
+Checkpointer::~Checkpointer() {
+    finish();
+}
+
+double Checkpointer::copy(bool lock) {
+    auto start = Clock::now();
+    for (size_t i = 0; i < snapshot_.size(); i++) {
+        std::unique_lock<std::mutex> row_lock(flags_->at(i), std::defer_lock);
+        if (lock) {
+            row_lock.lock();
+        }
+        // the rows not updated since are still those of the snapshot
+        changed_[i] = !dirty_ || (*dirty_)[i];
+        if (changed_[i]) {
+            snapshot_[i] = vectors_->at(i);
+            rows_copied_++;
+            if (dirty_) {
+                (*dirty_)[i] = 0;
+            }
+        }
+    }
+    return seconds_since(start);
+}
+
+void Checkpointer::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        cv_.wait(lock, [this]() { return stopping_ || !name_.empty(); });
+        if (name_.empty()) {
+            return;
+        }
+        std::string name = name_;
+        bool copied = copied_;
+        bool delta = delta_;
+        lock.unlock();
+        double copy_seconds = copied ? 0. : copy(true);
+        auto start = Clock::now();
+        writer_(name, snapshot_, delta ? &changed_ : nullptr);
+        double write_seconds = seconds_since(start);
+        lock.lock();
+        copy_seconds_ += copy_seconds;
+        write_seconds_ += write_seconds;
+        taken_++;
+        name_.clear();
+        cv_.notify_all();
+    }
+}
+
+bool Checkpointer::request(const std::string& name, bool wait, bool copy_now, bool delta) {
+    auto start = Clock::now();
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!name_.empty()) {
+        if (!wait) {
+            dropped_++;
+            return false;
+        }
+        cv_.wait(lock, [this]() { return name_.empty(); });
+    }
+    if (copy_now) {
+        // the background thread is idle, so the snapshot is ours
+        copy(false);
+    }
+    name_ = name;
+    copied_ = copy_now;
+    delta_ = delta;
+    cv_.notify_all();
+    stall_seconds_ += seconds_since(start);
+    return true;
+}
+
+void Checkpointer::finish() {
+    auto start = Clock::now();
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (stopping_) {
+            return;
+        }
+        cv_.wait(lock, [this]() { return name_.empty(); });
+        stopping_ = true;
+        cv_.notify_all();
+    }
+    thread_.join();
+    stall_seconds_ += seconds_since(start);
+}
+
+void Checkpointer::print_stats() const {
+    std::cerr << "Checkpoints: " << taken_ << " taken in the background (copying " << rows_copied_
+              << " rows in " << copy_seconds_ << "s, writing " << write_seconds_ << "s), " << dropped_
+              << " dropped while another was being taken; training stalled for "
+              << stall_seconds_ << "s" << std::endl;
+}
+
+}
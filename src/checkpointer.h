@@ -0,0 +1,106 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "vector.h"
+
+namespace minkowski {
+
+/*
+ * Takes checkpoints of vectors that are being trained, on a background
+ * thread: a checkpoint is a copy of the rows (a snapshot), taken a row at a
+ * time under the row's lock, so that training continues meanwhile, and
+ * written from the copy.  Each row of a snapshot is consistent, but
+ * different rows may be copied before and after a given update.  One
+ * checkpoint is taken at a time; the snapshot takes as much memory as the
+ * rows.  If the rows updated are tracked (see Model::track_dirty), only
+ * those updated since the previous checkpoint are copied, and a checkpoint
+ * may be written as a delta of them.
+ */
+class Checkpointer {
+public:
+    /*
+     * Writes the checkpoint of the given name from the snapshot.  For a
+     * delta checkpoint, `changed` marks the rows that changed since the
+     * previous checkpoint; it is null for a full one.
+     */
+    typedef std::function<void(const std::string&, const std::vector<Vector>&,
+                               const std::vector<uint8_t>*)> Writer;
+
+protected:
+    std::shared_ptr<std::vector<Vector>> vectors_;
+    std::shared_ptr<std::vector<std::mutex>> flags_;
+    std::shared_ptr<std::vector<uint8_t>> dirty_; // rows updated, if tracked
+    Writer writer_;
+    std::vector<Vector> snapshot_; // of the first rows of vectors_
+    std::vector<uint8_t> changed_; // rows copied into it by the last copy
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::string name_;  // of the checkpoint being taken, empty if none
+    bool copied_;       // whether snapshot_ holds it already
+    bool delta_;        // whether it is written as a delta
+    bool stopping_;
+    std::thread thread_;
+
+    int64_t taken_;
+    int64_t dropped_;
+    int64_t rows_copied_;
+    double copy_seconds_;  // on the background thread
+    double write_seconds_;
+    double stall_seconds_; // of the threads requesting checkpoints
+
+    /*
+     * Copy the rows updated since the last copy (all of them, if not
+     * tracked) into snapshot_, marking them in changed_, under their locks
+     * if `lock`; return the time taken, in seconds.
+     */
+    double copy(bool lock);
+
+    void run();
+
+public:
+    /*
+     * Checkpoints of the first `rows` rows of `vectors`, whose locks are
+     * `flags`.  `dirty`, if not null, tracks the rows updated, and is
+     * cleared as they are copied; all rows must be marked at first.
+     */
+    Checkpointer(std::shared_ptr<std::vector<Vector>> vectors,
+                 std::shared_ptr<std::vector<std::mutex>> flags,
+                 std::shared_ptr<std::vector<uint8_t>> dirty, int64_t rows, Writer writer);
+    ~Checkpointer();
+    Checkpointer(const Checkpointer&) = delete;
+    Checkpointer& operator=(const Checkpointer&) = delete;
+
+    /*
+     * Request a checkpoint of the given name.  If one is still being taken,
+     * wait for it if `wait`, or else drop the request and return false.  If
+     * `copy_now`, the snapshot is copied before returning, without taking the
+     * locks of the rows (e.g. when no thread is training), and only written
+     * in the background.  If `delta`, it is written as a delta of the rows
+     * changed since the previous checkpoint (which needs them tracked).
+     */
+    bool request(const std::string& name, bool wait, bool copy_now, bool delta = false);
+
+    /*
+     * Wait for the checkpoint being taken, if any, and stop the background
+     * thread.
+     */
+    void finish();
+
+    /*
+     * Report the number of checkpoints taken and dropped, the rows copied
+     * and the time spent on them in the background, and the time the
+     * requesting threads were stalled.
+     */
+    void print_stats() const;
+};
+
+}
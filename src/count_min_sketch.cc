@@ -0,0 +1,57 @@
+#include "count_min_sketch.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace minkowski {
+
+// odd, with well mixed high bits
+const uint64_t CountMinSketch::MULTIPLIERS[CountMinSketch::DEPTH] = {
+    0x9E3779B97F4A7C15ull, 0xBF58476D1CE4E5B9ull, 0x94D049BB133111EBull, 0xD6E8FEB86659FD93ull
+};
+
+CountMinSketch::CountMinSketch(int64_t bytes) : width_(2), shift_(63) {
+    if (bytes < int64_t(DEPTH * 2 * sizeof(uint32_t))) {
+        throw std::invalid_argument("Too little memory for a count-min sketch.");
+    }
+    while (width_ < (int64_t(1) << 32) && 2 * width_ * DEPTH * int64_t(sizeof(uint32_t)) <= bytes) {
+        width_ *= 2;
+        shift_--;
+    }
+    counters_.assign(DEPTH * width_, 0);
+}
+
+uint32_t CountMinSketch::add(uint64_t key) {
+    int64_t indices[DEPTH];
+    uint32_t least = std::numeric_limits<uint32_t>::max();
+    for (int32_t row = 0; row < DEPTH; row++) {
+        indices[row] = index(key, row);
+        least = std::min(least, counters_[indices[row]]);
+    }
+    if (least == std::numeric_limits<uint32_t>::max()) {
+        return least; // saturated
+    }
+    least++;
+    for (int32_t row = 0; row < DEPTH; row++) {
+        counters_[indices[row]] = std::max(counters_[indices[row]], least);
+    }
+    return least;
+}
+
+void CountMinSketch::raise(uint64_t key, uint32_t count) {
+    for (int32_t row = 0; row < DEPTH; row++) {
+        uint32_t& counter = counters_[index(key, row)];
+        counter = std::max(counter, count);
+    }
+}
+
+uint32_t CountMinSketch::estimate(uint64_t key) const {
+    uint32_t least = std::numeric_limits<uint32_t>::max();
+    for (int32_t row = 0; row < DEPTH; row++) {
+        least = std::min(least, counters_[index(key, row)]);
+    }
+    return least;
+}
+
+}
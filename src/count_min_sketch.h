@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace minkowski {
+
+/*
+ * A count-min sketch with conservative update: approximate counts of keys
+ * (given by 64-bit hashes) in a fixed amount of memory.  Each of DEPTH rows
+ * of 32-bit counters is indexed by its own multiply-shift hash of the key,
+ * and an estimate is the least of the key's counters, so it is never less
+ * than the number of times the key was added (nor, with conservative
+ * update, which only raises the counters that are below the new estimate,
+ * more than it need be).
+ */
+class CountMinSketch {
+protected:
+    std::vector<uint32_t> counters_; // DEPTH rows of width_ counters
+    int64_t width_;
+    int32_t shift_; // 64 - log2(width_)
+
+    inline int64_t index(uint64_t key, int32_t row) const {
+        return row * width_ + int64_t((key * MULTIPLIERS[row]) >> shift_);
+    }
+
+public:
+    static const int32_t DEPTH = 4;
+    static const uint64_t MULTIPLIERS[DEPTH];
+
+    /*
+     * A sketch of at most `bytes` bytes (its width is a power of two).
+     * Throws invalid_argument if that is too little for a row of two counters.
+     */
+    explicit CountMinSketch(int64_t bytes);
+
+    /*
+     * Count an occurrence of the key, and return its new estimate.
+     */
+    uint32_t add(uint64_t key);
+
+    /*
+     * Raise the estimate of the key to at least `count` (e.g. when a key
+     * counted elsewhere is returned to the sketch).
+     */
+    void raise(uint64_t key, uint32_t count);
+
+    /*
+     * Return the estimated number of occurrences of the key.
+     */
+    uint32_t estimate(uint64_t key) const;
+
+    int64_t width() const {
+        return width_;
+    }
+};
+
+}
@@ -7,46 +7,153 @@
 #include <algorithm>
 #include <iterator>
 #include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+
+#include "count_min_sketch.h"
+#include "utils.h"
 
 namespace minkowski {
 
 const std::string Dictionary::EOS = "</s>";
 
+constexpr int32_t VOCABULARY_MAGIC = 0x4d4b5642; // "MKVB"
+constexpr int32_t VOCABULARY_VERSION = 1;
+
+// initial number of slots of the hash table
+constexpr int64_t MIN_TABLE_SIZE = 1024;
+// the table is doubled once more than this fraction of its slots are used
+constexpr double MAX_LOAD_FACTOR = 0.7;
+// memory taken by a word counted exactly by count_within_memory, taken to be
+// that of its entry, its string and the node of its map
+constexpr int64_t EXACT_WORD_BYTES = 96;
+
 Dictionary::Dictionary(std::shared_ptr<Args> args) : args_(args),
-    word2int_(HASHTABLE_SIZE, -1), size_(0), nwords_(0),
+    word2int_(MIN_TABLE_SIZE, -1), size_(0), nwords_(0),
     ntokens_(0) {}
 
-int32_t Dictionary::find(const std::string& w) const {
-    uint32_t h = hash(w);
-    int32_t idx = h % HASHTABLE_SIZE;
-    while (word2int_[idx] != -1 && words_[word2int_[idx]].word != w) {
-        idx = (idx + 1) % HASHTABLE_SIZE;
+int64_t Dictionary::find(const std::string& w) const {
+    return find(w, hash(w));
+}
+
+int64_t Dictionary::find(const std::string& w, uint32_t h) const {
+    const int64_t mask = word2int_.size() - 1;
+    int64_t idx = h & mask;
+    while (word2int_[idx] != -1 &&
+           (word_hashes_[word2int_[idx]] != h || words_[word2int_[idx]].word != w)) {
+        idx = (idx + 1) & mask;
     }
     return idx;
 }
 
+void Dictionary::add_word(const entry& e, int64_t slot, uint32_t h) {
+    if (size_ == std::numeric_limits<int32_t>::max()) {
+        throw std::invalid_argument("Vocabulary too large: try a higher -min-count.");
+    }
+    // stale until the vocabulary is complete again
+    frozen_slots_.clear();
+    words_.push_back(e);
+    word_hashes_.push_back(h);
+    word2int_[slot] = size_++;
+    if (size_ > MAX_LOAD_FACTOR * word2int_.size()) {
+        rebuild_table(2 * word2int_.size());
+    }
+}
+
+void Dictionary::rebuild_table(int64_t table_size) {
+    word2int_.assign(table_size, -1);
+    const int64_t mask = table_size - 1;
+    for (int32_t id = 0; id < size_; id++) {
+        int64_t idx = word_hashes_[id] & mask;
+        while (word2int_[idx] != -1) {
+            idx = (idx + 1) & mask;
+        }
+        word2int_[idx] = id;
+    }
+}
+
+void Dictionary::index_words() {
+    size_ = words_.size();
+    nwords_ = size_;
+    word_hashes_.resize(size_);
+    for (int32_t id = 0; id < size_; id++) {
+        word_hashes_[id] = hash(words_[id].word);
+    }
+    int64_t table_size = MIN_TABLE_SIZE;
+    while (table_size < 2 * int64_t(size_)) {
+        table_size *= 2;
+    }
+    rebuild_table(table_size);
+    word2int_.shrink_to_fit();
+}
+
+uint64_t Dictionary::frozen_hash(const char* data, size_t length) {
+    const uint64_t m = 0x9E3779B97F4A7C15ull;
+    uint64_t h = length * m;
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        uint64_t chunk;
+        memcpy(&chunk, data + i, 8);
+        h = (h ^ chunk) * m;
+        h ^= h >> 29;
+    }
+    if (i < length) {
+        uint64_t chunk = 0;
+        memcpy(&chunk, data + i, length - i);
+        h = (h ^ chunk) * m;
+        h ^= h >> 29;
+    }
+    // finalize as splitmix64
+    h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ull;
+    h = (h ^ (h >> 27)) * 0x94D049BB133111EBull;
+    return h ^ (h >> 31);
+}
+
+void Dictionary::freeze() {
+    int64_t table_size = MIN_TABLE_SIZE;
+    while (table_size < 2 * int64_t(size_)) {
+        table_size *= 2;
+    }
+    frozen_keys_.clear();
+    for (int32_t id = 0; id < size_; id++) {
+        frozen_keys_ += words_[id].word;
+    }
+    if (frozen_keys_.size() > std::numeric_limits<uint32_t>::max()) {
+        // offsets are 32-bit: keep looking up in words_
+        frozen_keys_.clear();
+        frozen_slots_.clear();
+        return;
+    }
+    frozen_slots_.assign(table_size, FrozenSlot{0, 0, -1, 0});
+    const int64_t mask = table_size - 1;
+    uint32_t offset = 0;
+    for (int32_t id = 0; id < size_; id++) {
+        const std::string& word = words_[id].word;
+        uint64_t h = frozen_hash(word.data(), word.size());
+        int64_t idx = h & mask;
+        while (frozen_slots_[idx].id != -1) {
+            idx = (idx + 1) & mask;
+        }
+        frozen_slots_[idx] = FrozenSlot{uint32_t(h >> 32), uint32_t(word.size()), id, offset};
+        offset += word.size();
+    }
+}
+
 void Dictionary::record_occurrence(const std::string& w) {
-    int32_t h = find(w);
+    uint32_t h = hash(w);
+    int64_t slot = find(w, h);
     ntokens_++;
-    if (word2int_[h] == -1) {
+    if (word2int_[slot] == -1) {
         // word is not yet in the dictionary, so add it
-        entry e;
-        e.word = w;
-        e.count = 1;
-        words_.push_back(e);
-        word2int_[h] = size_++;
+        add_word(entry{w, 1}, slot, h);
     } else {
         // word _is_ in the dictionary, so just increment its count
-        words_[word2int_[h]].count++;
+        words_[word2int_[slot]].count++;
     }
 }
 
-bool Dictionary::discard(int32_t id, real rand) const {
-    assert(id >= 0);
-    assert(id < nwords_);
-    return rand > retention_probas[id];
-}
-
 uint32_t Dictionary::hash(const std::string& str) const {
     uint32_t h = 2166136261;
     for (size_t i = 0; i < str.size(); i++) {
@@ -92,12 +199,252 @@ void Dictionary::determine_vocabulary(std::istream& in) {
         if (ntokens_ % 1000000 == 0) {
             std::cerr << "\rRead " << ntokens_  / 1000000 << "M words" << std::flush;
         }
-        if (size_ > 0.75 * HASHTABLE_SIZE) {
-            throw std::invalid_argument("Vocabulary getting too large for hash table: try a higher -min-count.");
+    }
+    finish_vocabulary();
+}
+
+/*
+ * Return the bounds of `count` ranges of whole lines that partition
+ * [begin, end), of about equal size.
+ */
+static std::vector<const char*> split_lines(const char* begin, const char* end, int32_t count) {
+    std::vector<const char*> bounds(count + 1, end);
+    bounds[0] = begin;
+    for (int32_t i = 1; i < count; i++) {
+        const char* p = std::max(begin + (end - begin) * i / count, bounds[i - 1]);
+        while (p > begin && p < end && p[-1] != '\n') {
+            p++;
+        }
+        bounds[i] = p;
+    }
+    return bounds;
+}
+
+void Dictionary::determine_vocabulary(const char* begin, const char* end) {
+    if (args_->count_memory > 0) {
+        // half of the memory for the sketches, half for the words counted
+        // exactly
+        const int64_t bytes = int64_t(args_->count_memory) << 20;
+        const int64_t exact_words = bytes / 2 / EXACT_WORD_BYTES;
+        const int64_t needed_words = count_within_memory(begin, end, bytes / 2, exact_words);
+        if (needed_words > exact_words) {
+            std::cerr << "Warning: -count-memory " << args_->count_memory << " is too small for the words"
+                      << " counted exactly; try -count-memory "
+                      << ((2 * needed_words * EXACT_WORD_BYTES + (int64_t(1) << 20) - 1) >> 20) << std::endl;
+        }
+        if (args_->verify_counts) {
+            verify_counts(begin, end);
+        } else {
+            std::cerr << "Warning: the counts are approximate (upper bounds of the true counts);"
+                      << " -verify-counts 1 counts them exactly" << std::endl;
+        }
+        finish_vocabulary();
+        return;
+    }
+    // the words of a range, in order of first occurrence, with their counts
+    struct Shard {
+        std::vector<entry> words;
+        std::unordered_map<std::string, int32_t> ids;
+        int64_t ntokens = 0;
+    };
+    const int32_t num_shards = std::max(args_->threads, 1);
+    std::vector<const char*> bounds = split_lines(begin, end, num_shards);
+    std::vector<Shard> shards(num_shards);
+    std::vector<std::thread> threads;
+    for (int32_t i = 0; i < num_shards; i++) {
+        threads.push_back(std::thread([&, i]() {
+            utils::MemoryStream in(bounds[i], bounds[i + 1]);
+            Shard& shard = shards[i];
+            std::string word;
+            while (read_word(in, word)) {
+                shard.ntokens++;
+                auto it = shard.ids.find(word);
+                if (it == shard.ids.end()) {
+                    shard.ids.insert(std::make_pair(word, int32_t(shard.words.size())));
+                    shard.words.push_back(entry{word, 1});
+                } else {
+                    shard.words[it->second].count++;
+                }
+            }
+            shard.ids.clear();
+        }));
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    // words new to the dictionary are added in order, as by record_occurrence
+    for (auto& shard : shards) {
+        for (auto& e : shard.words) {
+            uint32_t h = hash(e.word);
+            int64_t slot = find(e.word, h);
+            if (word2int_[slot] == -1) {
+                add_word(e, slot, h);
+            } else {
+                words_[word2int_[slot]].count += e.count;
+            }
+        }
+        ntokens_ += shard.ntokens;
+        shard.words.clear();
+    }
+    finish_vocabulary();
+}
+
+int64_t Dictionary::count_within_memory(const char* begin, const char* end, int64_t sketch_bytes,
+                                        int64_t exact_words) {
+    // the words of a range counted exactly, in order of promotion
+    struct Shard {
+        std::unique_ptr<CountMinSketch> sketch;
+        std::vector<entry> words;
+        std::unordered_map<std::string, int32_t> ids;
+        int64_t ntokens = 0;
+        int64_t promoted = 0;
+        int64_t repromoted = 0;
+        int64_t evicted = 0;
+    };
+    const int32_t num_shards = std::max(args_->threads, 1);
+    const int64_t capacity = std::max(exact_words / num_shards, int64_t(2));
+    // a word occurring -min-count times occurs this often in one of the ranges
+    const int64_t threshold = std::max((int64_t(args_->min_count) + num_shards - 1) / num_shards, int64_t(1));
+    std::vector<const char*> bounds = split_lines(begin, end, num_shards);
+    std::vector<Shard> shards(num_shards);
+    for (auto& shard : shards) {
+        shard.sketch.reset(new CountMinSketch(sketch_bytes / num_shards));
+    }
+    std::vector<std::thread> threads;
+    for (int32_t i = 0; i < num_shards; i++) {
+        threads.push_back(std::thread([&, i]() {
+            utils::MemoryStream in(bounds[i], bounds[i + 1]);
+            Shard& shard = shards[i];
+            std::string word;
+            while (read_word(in, word)) {
+                shard.ntokens++;
+                auto it = shard.ids.find(word);
+                if (it != shard.ids.end()) {
+                    shard.words[it->second].count++;
+                    continue;
+                }
+                // the words counted exactly are no longer added to the
+                // sketch, so that the rarer words collide with them less
+                uint32_t estimate = shard.sketch->add(frozen_hash(word.data(), word.size()));
+                if (estimate < threshold) {
+                    continue;
+                }
+                if (shard.words.size() == capacity) {
+                    // return the less frequent half to the sketch, at their
+                    // counts, and keep the order of the others
+                    std::vector<int64_t> counts;
+                    for (auto& e : shard.words) {
+                        counts.push_back(e.count);
+                    }
+                    std::nth_element(counts.begin(), counts.begin() + counts.size() / 2, counts.end());
+                    const int64_t median = counts[counts.size() / 2];
+                    std::vector<entry> kept;
+                    shard.ids.clear();
+                    for (auto& e : shard.words) {
+                        if (e.count > median) {
+                            shard.ids[e.word] = kept.size();
+                            kept.push_back(e);
+                        } else {
+                            shard.sketch->raise(frozen_hash(e.word.data(), e.word.size()),
+                                                uint32_t(std::min(e.count, int64_t(std::numeric_limits<uint32_t>::max()))));
+                            shard.evicted++;
+                        }
+                    }
+                    shard.words.swap(kept);
+                }
+                shard.ids[word] = shard.words.size();
+                shard.words.push_back(entry{word, estimate});
+                shard.promoted++;
+                // a word returned to the sketch was raised to at least the
+                // threshold, so is past it when promoted again (as, rarely, is
+                // a word whose counters other words raised)
+                if (estimate > threshold) {
+                    shard.repromoted++;
+                }
+            }
+        }));
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    // a word counted exactly in one of the ranges, in order, with the sum of
+    // its counts in all of them (exact, or else estimated)
+    int64_t returned = 0;
+    int64_t most_promoted = 0;
+    for (auto& shard : shards) {
+        for (auto& e : shard.words) {
+            uint32_t h = hash(e.word);
+            int64_t slot = find(e.word, h);
+            if (word2int_[slot] != -1) {
+                continue;
+            }
+            int64_t count = 0;
+            for (auto& other : shards) {
+                auto it = other.ids.find(e.word);
+                count += it != other.ids.end() ? other.words[it->second].count
+                                               : other.sketch->estimate(frozen_hash(e.word.data(), e.word.size()));
+            }
+            add_word(entry{e.word, count}, slot, h);
+        }
+        ntokens_ += shard.ntokens;
+        if (shard.evicted > 0) {
+            // the distinct words promoted, which the table could not hold
+            returned += std::max(shard.evicted - shard.repromoted, int64_t(0));
+            most_promoted = std::max(most_promoted, std::max(shard.promoted - shard.repromoted, capacity + 1));
+        } else {
+            most_promoted = std::max(most_promoted, shard.promoted);
         }
     }
+    nwords_ = size_;
+    std::cerr << "\rRead " << ntokens_  / 1000000 << "M words, " << size_ << " counted exactly (sketches of "
+              << CountMinSketch::DEPTH << " x " << shards[0].sketch->width() << ")" << std::endl;
+    if (most_promoted > capacity) {
+        std::cerr << "Warning: the tables of words counted exactly overflowed, and up to " << returned
+                  << " words returned to the sketches may be missing from the vocabulary" << std::endl;
+    }
+    // the words promoted to the fullest table, in a table of that size for
+    // each range
+    return most_promoted * num_shards;
+}
+
+void Dictionary::verify_counts(const char* begin, const char* end) {
+    freeze();
+    const int32_t num_shards = std::max(args_->threads, 1);
+    std::vector<const char*> bounds = split_lines(begin, end, num_shards);
+    std::vector<std::vector<int64_t>> counts(num_shards);
+    std::vector<std::thread> threads;
+    for (int32_t i = 0; i < num_shards; i++) {
+        threads.push_back(std::thread([&, i]() {
+            counts[i].assign(size_, 0);
+            utils::MemoryStream in(bounds[i], bounds[i + 1]);
+            std::string word;
+            while (read_word(in, word)) {
+                int32_t id = get_id(word);
+                if (id >= 0) {
+                    counts[i][id]++;
+                }
+            }
+        }));
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    int64_t overcounted = 0;
+    for (int32_t id = 0; id < size_; id++) {
+        int64_t count = 0;
+        for (auto& shard : counts) {
+            count += shard[id];
+        }
+        overcounted += words_[id].count - count;
+        words_[id].count = count;
+    }
+    std::cerr << "Verified the counts, " << overcounted << " tokens overcounted" << std::endl;
+}
+
+void Dictionary::finish_vocabulary() {
     threshold(args_->min_count);
     calculate_retention_probas();
+    freeze();
     std::cerr << "\rRead " << ntokens_  / 1000000 << "M words" << std::endl;
     std::cerr << "Number of words:  " << nwords_ << std::endl;
     if (size_ == 0) {
@@ -107,25 +454,31 @@ void Dictionary::determine_vocabulary(std::istream& in) {
 }
 
 void Dictionary::threshold(int64_t t) {
-    sort(words_.begin(), words_.end(), [](const entry& e1, const entry& e2) {
+    // words of equal count stay in order of first occurrence (or of id)
+    std::stable_sort(words_.begin(), words_.end(), [](const entry& e1, const entry& e2) {
         return e1.count > e2.count;
     });
+    // keep the counts of the rarer words, which may yet reach the threshold
+    // as the vocabulary grows
+    candidates_.clear();
+    for (auto it = words_.begin(); keeps_candidates() && it != words_.end(); ++it) {
+        if (it->count < t) {
+            candidates_[it->word] = it->count;
+        }
+    }
     words_.erase(remove_if(words_.begin(), words_.end(), [&](const entry& e) {
         return (e.count < t);
     }), words_.end());
     words_.shrink_to_fit();
-    size_ = 0;
-    nwords_ = 0;
-    std::fill(word2int_.begin(), word2int_.end(), -1);
-    for (auto it = words_.begin(); it != words_.end(); ++it) {
-        int32_t h = find(it->word);
-        word2int_[h] = size_++;
-        nwords_++;
-    }
+    index_words();
+}
+
+bool Dictionary::keeps_candidates() const {
+    return !args_->save_vocab.empty() || (!args_->read_vocab.empty() && args_->grow_vocab);
 }
 
 void Dictionary::calculate_retention_probas() {
-    retention_probas.resize(size_);
+    retention_thresholds_.resize(size_);
     real proba;
     for (size_t i = 0; i < size_; i++) {
         if (args_->t > 0) {
@@ -134,11 +487,160 @@ void Dictionary::calculate_retention_probas() {
             if (proba > 1.) {
                 proba = 1.;
             }
-            retention_probas[i] = proba;
         } else {
-            retention_probas[i] = 1.;
+            proba = 1.;
+        }
+        // retained iff the 32-bit random outcome is <= the threshold
+        retention_thresholds_[i] = uint32_t(std::min(std::floor(proba * 4294967296.), 4294967295.));
+    }
+}
+
+void Dictionary::save_vocabulary(std::ostream& out) const {
+    std::vector<const std::string*> words;
+    std::vector<int64_t> counts, ends;
+    for (auto& e : words_) {
+        words.push_back(&e.word);
+        counts.push_back(e.count);
+    }
+    for (auto& candidate : candidates_) {
+        words.push_back(&candidate.first);
+        counts.push_back(candidate.second);
+    }
+    int64_t end = 0;
+    for (auto word : words) {
+        end += word->size();
+        ends.push_back(end);
+    }
+    utils::write_value(out, VOCABULARY_MAGIC);
+    utils::write_value(out, VOCABULARY_VERSION);
+    utils::write_value(out, ntokens_);
+    utils::write_value(out, int64_t(words_.size()));
+    utils::write_value(out, int64_t(candidates_.size()));
+    out.write(reinterpret_cast<const char*>(counts.data()), counts.size() * sizeof(int64_t));
+    out.write(reinterpret_cast<const char*>(ends.data()), ends.size() * sizeof(int64_t));
+    for (auto word : words) {
+        out.write(word->data(), word->size());
+    }
+}
+
+void Dictionary::read_vocabulary(const char* begin, const char* end) {
+    load_vocabulary(begin, end);
+    // all words seen, so that -min-count and -t may differ from the run
+    // that saved them
+    finish_vocabulary();
+}
+
+void Dictionary::restore_vocabulary(const char* begin, const char* end) {
+    int64_t num_words = load_vocabulary(begin, end);
+    candidates_.clear();
+    for (int64_t i = num_words; keeps_candidates() && i < words_.size(); i++) {
+        candidates_[words_[i].word] = words_[i].count;
+    }
+    words_.resize(num_words);
+    index_words();
+    calculate_retention_probas();
+    freeze();
+}
+
+int64_t Dictionary::load_vocabulary(const char* begin, const char* end) {
+    // the header, then the counts and end offsets of all words, are 8-byte
+    // aligned, so are read in place
+    const int64_t header_size = 2 * sizeof(int32_t) + 3 * sizeof(int64_t);
+    if (end - begin < header_size ||
+            *reinterpret_cast<const int32_t*>(begin) != VOCABULARY_MAGIC ||
+            *reinterpret_cast<const int32_t*>(begin + sizeof(int32_t)) != VOCABULARY_VERSION) {
+        throw std::invalid_argument("Not a vocabulary file (see -save-vocab).");
+    }
+    const int64_t* header = reinterpret_cast<const int64_t*>(begin + 2 * sizeof(int32_t));
+    int64_t ntokens = header[0];
+    int64_t num_entries = header[1] + header[2];
+    const int64_t* counts = header + 3;
+    const int64_t* ends = counts + num_entries;
+    const char* chars = reinterpret_cast<const char*>(ends + num_entries);
+    if (header[1] < 0 || header[2] < 0 || num_entries < 0 ||
+            (end - begin - header_size) / int64_t(2 * sizeof(int64_t)) < num_entries ||
+            (num_entries > 0 && ends[num_entries - 1] != end - chars)) {
+        throw std::invalid_argument("Truncated vocabulary file.");
+    }
+    // each word ends where the next starts, within the strings
+    for (int64_t i = 0; i < num_entries; i++) {
+        if (ends[i] < (i > 0 ? ends[i - 1] : 0) || ends[i] > end - chars) {
+            throw std::invalid_argument("Corrupt vocabulary file.");
         }
     }
+    words_.clear();
+    words_.reserve(num_entries);
+    int64_t start = 0;
+    for (int64_t i = 0; i < num_entries; i++) {
+        words_.push_back(entry{std::string(chars + start, ends[i] - start), counts[i]});
+        start = ends[i];
+    }
+    ntokens_ = ntokens;
+    return header[1];
+}
+
+void Dictionary::update_vocabulary(std::istream& in) {
+    std::string word;
+    int32_t promoted = 0;
+    while (read_word(in, word)) {
+        ntokens_++;
+        if (ntokens_ % 1000000 == 0) {
+            std::cerr << "\rRead " << ntokens_  / 1000000 << "M words" << std::flush;
+        }
+        uint32_t h = hash(word);
+        int64_t slot = find(word, h);
+        if (word2int_[slot] != -1) {
+            words_[word2int_[slot]].count++;
+            continue;
+        }
+        int64_t& count = candidates_[word];
+        if (++count >= args_->min_count) {
+            // promoted, with the next id, so that no other word moves
+            add_word(entry{word, count}, slot, h);
+            nwords_++;
+            candidates_.erase(word);
+            promoted++;
+        }
+    }
+    calculate_retention_probas();
+    freeze();
+    std::cerr << "\rRead " << ntokens_  / 1000000 << "M words" << std::endl;
+    std::cerr << "Number of words:  " << nwords_ << " (" << promoted << " new)" << std::endl;
+}
+
+int32_t Dictionary::get_id(const std::string& word) const {
+    if (frozen_slots_.empty()) {
+        return word2int_[find(word)];
+    }
+    uint64_t h = frozen_hash(word.data(), word.size());
+    const uint32_t tag = h >> 32;
+    const uint32_t length = word.size();
+    const int64_t mask = frozen_slots_.size() - 1;
+    for (int64_t idx = h & mask; ; idx = (idx + 1) & mask) {
+        const FrozenSlot& slot = frozen_slots_[idx];
+        if (slot.id == -1) {
+            return -1;
+        }
+        if (slot.hash == tag && slot.length == length &&
+                memcmp(&frozen_keys_[slot.offset], word.data(), length) == 0) {
+            return slot.id;
+        }
+    }
+}
+
+void Dictionary::set_vocabulary(const std::vector<entry>& words) {
+    if (words.size() >= std::numeric_limits<int32_t>::max()) {
+        throw std::invalid_argument("Vocabulary too large.");
+    }
+    words_ = words;
+    candidates_.clear();
+    index_words();
+    ntokens_ = 0;
+    for (auto& e : words_) {
+        ntokens_ += e.count;
+    }
+    calculate_retention_probas();
+    freeze();
 }
 
 std::vector<int64_t> Dictionary::get_counts() const {
@@ -149,30 +651,61 @@ std::vector<int64_t> Dictionary::get_counts() const {
     return counts;
 }
 
-int32_t Dictionary::get_line(std::istream& in,
-                             std::vector<int32_t>& words,
-                             std::minstd_rand& rng) const {
-    std::uniform_real_distribution<> uniform(0, 1);
-    std::string token;
-    int32_t ntokens = 0; // number of vocab tokens consumed
-
-    // reset to the beginning of the stream, if at the end
-    if (in.eof()) {
-        in.clear();
-        in.seekg(std::streampos(0));
+int32_t Dictionary::get_chunk(std::istream& in,
+                              std::vector<int32_t>& words,
+                              const Philox& rng,
+                              LinePosition& position,
+                              int32_t max_tokens) const {
+    if (position.in_line) {
+        // keep the context of the centers still to come
+        int32_t carry = std::max(0, position.end - args_->window_size);
+        words.erase(words.begin(), words.begin() + carry);
+        position.begin = position.end - carry;
+    } else {
+        // reset to the beginning of the stream, if at the end
+        if (in.eof()) {
+            in.clear();
+            in.seekg(std::streampos(0));
+        }
+        position.in_line = true;
+        position.line_offset = in.tellg();
+        position.token_index = 0;
+        position.begin = 0;
+        words.clear();
     }
 
-    words.clear();
-    while (read_word(in, token)) {
-        int32_t h = find(token);
-        int32_t wid = word2int_[h];
+    std::string token;
+    int32_t ntokens = 0; // number of vocab tokens consumed
+    bool line_done = false;
+    // subsample in blocks of four tokens, one random block per counter value
+    uint32_t rand[4];
+    while (ntokens < max_tokens) {
+        if (!read_word(in, token)) {
+            line_done = true;
+            break;
+        }
+        int32_t wid = get_id(token);
         if (wid < 0) continue;
 
+        int64_t i = position.token_index++;
+        if (i % 4 == 0 || ntokens == 0) {
+            rng.block(position.line_offset, i / 4, rand);
+        }
         ntokens++;
-        if (!discard(wid, uniform(rng))) {
+        if (!discard(wid, rand[i % 4])) {
             words.push_back(wid);
         }
-        if (token == EOS) break;
+        if (token == EOS) {
+            line_done = true;
+            break;
+        }
+    }
+    if (line_done) {
+        position.in_line = false;
+        position.end = words.size();
+    } else {
+        // the last words lack their context to the right
+        position.end = std::max(position.begin, int32_t(words.size()) - args_->window_size);
     }
     return ntokens;
 }
@@ -4,11 +4,11 @@
 #include <string>
 #include <istream>
 #include <ostream>
-#include <random>
 #include <memory>
 #include <unordered_map>
 
 #include "args.h"
+#include "random.h"
 #include "real.h"
 
 namespace minkowski {
@@ -18,19 +18,32 @@ struct entry {
     int64_t count;
 };
 
+/*
+ * Where a reader is within a line of the corpus, carried by get_chunk from
+ * one chunk of the line to the next.  After each chunk, the words in
+ * [begin, end) are the centers of the chunk; the words before and after them
+ * are context shared with the neighbouring chunks.
+ */
+struct LinePosition {
+    bool in_line = false;     // the line continues with the next chunk
+    uint64_t line_offset = 0; // byte offset of the line
+    int64_t token_index = 0;  // within the line, of the next token
+    int32_t begin = 0;
+    int32_t end = 0;
+};
+
 class Dictionary {
 protected:
-    static const int32_t HASHTABLE_SIZE = 100000000;
-
     /*
      * Return the index into word2int_ of the specified word, or, if the
      * word is not in the dictionary, the index of the next available slot.
      * Post: word2int_[result] == -1 || words_[word2int_[result]].word == word
      */
-    int32_t find(const std::string& word) const;
+    int64_t find(const std::string& word) const;
+    int64_t find(const std::string& word, uint32_t h) const;
 
     /*
-     * Calculate the discard probabilities (used for subsampling).
+     * Calculate the retention thresholds (used for subsampling).
      */
     void calculate_retention_probas();
 
@@ -40,12 +53,66 @@ protected:
      * Hash table implementation.  Collisions are resolved by moving to the
      * next available slot.
      * word2int_ is a vector mapping hashes of strings (so ints) to indices of word_
-     * (so most of its values are -1)
+     * (so most of its values are -1); its size is a power of two, and it is
+     * doubled as the vocabulary grows
+     * word_hashes_ holds the hash of each word, by index into words_, so that
+     * the table can be rebuilt without rehashing the words
      * words_ is a vector of entry structs (which consist of a word (string) and its
      * occurrence count)
      */
     uint32_t hash(const std::string& str) const;
     std::vector<int32_t> word2int_;
+    std::vector<uint32_t> word_hashes_;
+
+    /*
+     * Append the word to words_, at the slot of word2int_ given by find,
+     * growing the table if it is getting full.
+     */
+    void add_word(const entry& e, int64_t slot, uint32_t h);
+
+    /*
+     * Rebuild word2int_ with the given number of slots (a power of two).
+     */
+    void rebuild_table(int64_t table_size);
+
+    /*
+     * Index all of words_ afresh, in a table of the smallest size that keeps
+     * it at most half full.
+     */
+    void index_words();
+
+    /*
+     * A slot of the frozen table: the upper half of the 64-bit hash of the
+     * word, its length, its id (-1 for an empty slot), and the offset of its
+     * characters in frozen_keys_.
+     */
+    struct FrozenSlot {
+        uint32_t hash;
+        uint32_t length;
+        int32_t id;
+        uint32_t offset;
+    };
+
+    /*
+     * The frozen table, a read-only copy of the vocabulary used for lookups
+     * once it is complete: open addressing over 16-byte slots, at most half
+     * full, with the characters of all words in one contiguous arena, so
+     * that a lookup touches a slot and, unless the hash and length differ,
+     * the word's characters, rather than the strings of words_.  Empty while
+     * the vocabulary is being built (or grown).
+     */
+    std::vector<FrozenSlot> frozen_slots_;
+    std::string frozen_keys_;
+
+    /*
+     * A 64-bit hash of the characters, processed eight at a time.
+     */
+    static uint64_t frozen_hash(const char* data, size_t length);
+
+    /*
+     * Build the frozen table from words_.
+     */
+    void freeze();
 
     /*
      * Record an occurrence of the specified word, adding it to the dictionary
@@ -53,13 +120,68 @@ protected:
      */
     void record_occurrence(const std::string&);
 
-    std::vector<real> retention_probas; // retention probability for each word
+    // the counts of the words seen less than -min-count times, if kept
+    std::unordered_map<std::string, int64_t> candidates_;
+
+    /*
+     * Return whether the words below -min-count are kept as candidates: only
+     * if they are saved (-save-vocab), or may yet be promoted (-grow-vocab).
+     */
+    bool keeps_candidates() const;
+
+    // retention probability of each word, scaled to a 32-bit integer threshold
+    std::vector<uint32_t> retention_thresholds_;
 
     /*
      * Discard all words that occur less than the specified number of times.
      */
     void threshold(int64_t);
 
+    /*
+     * Apply -min-count to the words counted, and report the vocabulary.
+     */
+    void finish_vocabulary();
+
+    /*
+     * Replace words_ by all words of a vocabulary written by save_vocabulary,
+     * held in [begin, end), and return the number of them that were in the
+     * vocabulary (rather than below -min-count).
+     */
+    int64_t load_vocabulary(const char* begin, const char* end);
+
+    /*
+     * Count the words of [begin, end) within a memory budget, with -threads
+     * threads, each over a range of whole lines with a count-min sketch of
+     * sketch_bytes / -threads bytes and a table of exact counts of its own:
+     * each token not in the table is counted in the sketch, and is added to
+     * the table once its estimate reaches -min-count / -threads (rounded
+     * up), with that estimate as its count so far; it is counted exactly
+     * from then on.  The words of the tables are added to words_ in order,
+     * each with the sum over the ranges of its exact or estimated counts.
+     * Since the estimates are never too low, and a word that occurs
+     * -min-count times occurs -min-count / -threads times in one of the
+     * ranges, words_ holds every word that occurs at least -min-count times
+     * (and the few others that collide with frequent words in the
+     * sketches), with a count that is at least its true count.
+     * The tables hold at most exact_words words between them: a full table
+     * returns its less frequent half to its sketch (raising their estimates
+     * to their counts), so a word that occurs -min-count times may then be
+     * missed, if it does not occur again in that range; a warning gives the
+     * number of words left in the sketches so (summed over the ranges, so at
+     * most that many are missed).  Returns the number of words the tables
+     * would need to hold between them for none to be returned: at most
+     * exact_words if none was, and otherwise an estimate (a word promoted
+     * again is told apart from a new one by its estimate, which other words
+     * can raise too).
+     */
+    int64_t count_within_memory(const char* begin, const char* end, int64_t sketch_bytes, int64_t exact_words);
+
+    /*
+     * Recount the words of words_ exactly over [begin, end), with -threads
+     * threads, each with counts of its own.
+     */
+    void verify_counts(const char* begin, const char* end);
+
 public:
     std::vector<entry> words_;
     static const std::string EOS;
@@ -71,9 +193,11 @@ public:
 
     /*
      * Return whether the specified word should be discarded, given the
-     * specified random outcome.
+     * specified uniformly distributed 32-bit random outcome.
      */
-    bool discard(int32_t id, real rand) const;
+    inline bool discard(int32_t id, uint32_t rand) const {
+        return rand > retention_thresholds_[id];
+    }
 
     /*
      * Extract the next word (=sequence of chars unbroken by whitespace) from
@@ -88,20 +212,100 @@ public:
      */
     void determine_vocabulary(std::istream&);
 
+    /*
+     * As for determine_vocabulary, counting the text in [begin, end) (e.g. a
+     * mapped file) with -threads threads, each over a range of whole lines
+     * with a hash map of its own.  The counts of the threads are merged in
+     * order, so that the vocabulary is the same as if it were counted by a
+     * single thread.
+     * With -count-memory, the words are instead counted within a memory
+     * budget (see count_within_memory; half of it for the sketches, half for
+     * the words counted exactly), then, with -verify-counts, recounted
+     * exactly, so that the vocabulary is that of exact counting (though its
+     * words of equal count may be in a different order), but the counts of
+     * only the few words below -min-count that were counted exactly are kept
+     * (e.g. for save_vocabulary).  A warning is printed when the counts are
+     * not verified, and when the budget was too small for the words counted
+     * exactly, with the -count-memory that would have sufficed.
+     */
+    void determine_vocabulary(const char* begin, const char* end);
+
+    /*
+     * Write the vocabulary, with the counts of all words seen (including
+     * those below -min-count, if kept; see keeps_candidates), in a binary
+     * format that can be read in place
+     * from a mapped file: a header of two int32 (magic and version) and three
+     * int64 (the number of tokens, of words and of the other words seen),
+     * then the int64 count of each word, in order of id and followed by the
+     * others, the int64 end offset of the characters of each, and their
+     * characters.  Numbers are stored in the byte order of the machine.
+     */
+    void save_vocabulary(std::ostream& out) const;
+
+    /*
+     * Replace the vocabulary by one written by save_vocabulary, held in
+     * [begin, end) (e.g. a mapped file), applying -min-count (and -t) afresh
+     * to the counts of all words seen.  Throws invalid_argument if it is not
+     * a vocabulary file, or is truncated or corrupt.
+     */
+    void read_vocabulary(const char* begin, const char* end);
+
+    /*
+     * As for read_vocabulary, but keeping the vocabulary as it was saved,
+     * with the same ids (as when resuming training).
+     */
+    void restore_vocabulary(const char* begin, const char* end);
+
+    /*
+     * Add the counts of the tokens of the input stream to the vocabulary.
+     * The words that reach -min-count are appended to it (so the ids of the
+     * existing words don't change, but the ids are no longer sorted by
+     * count).
+     */
+    void update_vocabulary(std::istream& in);
+
+    /*
+     * Return the id of the specified word, or -1 if it is not in the
+     * dictionary (from the frozen table, once the vocabulary is complete).
+     */
+    int32_t get_id(const std::string& word) const;
+
+    /*
+     * Replace the vocabulary by the given words, in the given order and with
+     * the given counts (as when read from a pair file); -min-count is not
+     * applied.
+     */
+    void set_vocabulary(const std::vector<entry>& words);
+
     /*
      * Return a vector giving the occurrence count of the words in the dictionary.
      */
     std::vector<int64_t> get_counts() const;
 
+    // dictionary tokens read per chunk of a line
+    static const int32_t MAX_CHUNK_TOKENS = 10000;
+
     /*
-     * Populate `words` with tokens read from the input stream, performing any
-     * subsampling.  Does not continue over linebreaks (\n).
+     * Read the next chunk of at most `max_tokens` dictionary tokens of the
+     * current line (or of the next line, if the last chunk ended it) from the
+     * input stream, performing any subsampling.  Does not continue over
+     * linebreaks (\n).  `words` must be passed unchanged from one chunk to
+     * the next: the last -window-size words of the centers of the previous
+     * chunk of the line, and the words after them, are kept at its start, and
+     * the last -window-size words of a chunk that doesn't end the line are
+     * only centers in the next, so that the centers of the chunks of a line,
+     * with their contexts, are those of the whole line.
+     * The subsampling randomness of each token is drawn from `rng` at the
+     * counter given by the byte offset of the line and the token's position
+     * within it, so it does not depend on which thread reads the line, nor on
+     * how it is chunked.
      * Returns the number of dictionary tokens consumed from the input stream
-     * in the processed (regardless of whether they were subsequently discarded
-     * due to subsampling).
+     * (regardless of whether they were subsequently discarded due to
+     * subsampling).
      */
-    int32_t get_line(std::istream& in, std::vector<int32_t>& words,
-                     std::minstd_rand& rng) const;
+    int32_t get_chunk(std::istream& in, std::vector<int32_t>& words,
+                      const Philox& rng, LinePosition& position,
+                      int32_t max_tokens = MAX_CHUNK_TOKENS) const;
 };
 
 }
@@ -0,0 +1,55 @@
+#include "huffman_tree.h"
+
+#include <cstdint>
+#include <stdexcept>
+
+namespace minkowski {
+
+HuffmanTree::HuffmanTree(const std::vector<int64_t>& counts) :
+    paths_(counts.size()), codes_(counts.size()) {
+    int32_t n = counts.size();
+    for (int32_t i = 1; i < n; i++) {
+        if (counts[i] > counts[i - 1]) {
+            throw std::invalid_argument("The counts of a Huffman tree must be sorted.");
+        }
+    }
+    if (n < 2) {
+        return;
+    }
+    std::vector<int64_t> node_counts(2 * n - 1, INT64_MAX);
+    std::vector<int32_t> parents(2 * n - 1, -1);
+    std::vector<bool> second_child(2 * n - 1, false);
+    for (int32_t i = 0; i < n; i++) {
+        node_counts[i] = counts[i];
+    }
+    // the leaves, in increasing order of count, and the internal nodes, in
+    // the order they are created, are both queues sorted by count
+    int32_t leaf = n - 1;
+    int32_t node = n;
+    for (int32_t i = n; i < 2 * n - 1; i++) {
+        int32_t children[2];
+        for (int32_t j = 0; j < 2; j++) {
+            if (leaf >= 0 && node_counts[leaf] < node_counts[node]) {
+                children[j] = leaf--;
+            } else {
+                children[j] = node++;
+            }
+        }
+        node_counts[i] = node_counts[children[0]] + node_counts[children[1]];
+        parents[children[0]] = i;
+        parents[children[1]] = i;
+        second_child[children[1]] = true;
+    }
+    for (int32_t i = 0; i < n; i++) {
+        for (int32_t j = i; parents[j] != -1; j = parents[j]) {
+            paths_[i].push_back(parents[j]);
+            codes_[i].push_back(second_child[j]);
+        }
+    }
+}
+
+int32_t HuffmanTree::internal_nodes() const {
+    return paths_.size() > 1 ? paths_.size() - 1 : 0;
+}
+
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace minkowski {
+
+/*
+ * The Huffman tree of the vocabulary, used by the hierarchical softmax as in
+ * word2vec and fastText.  The words are its leaves 0, ..., n - 1 and its
+ * n - 1 internal nodes are numbered n, ..., 2n - 2, so that they can be
+ * appended to the rows of the words; the root is the node 2n - 2, and a
+ * node is numbered after its children.
+ * Construction is O(n), since the counts are sorted.
+ */
+class HuffmanTree {
+protected:
+    // internal nodes on the path of each word, from the leaf up to the root,
+    // and the branch taken at each of them (true iff it is the second child)
+    std::vector<std::vector<int32_t>> paths_;
+    std::vector<std::vector<bool>> codes_;
+
+public:
+    /*
+     * Build the tree of the words with the given occurrence counts.
+     * Pre: the counts are non-increasing (as for Dictionary::get_counts).
+     */
+    explicit HuffmanTree(const std::vector<int64_t>& counts);
+
+    const std::vector<int32_t>& path(int32_t word) const {
+        return paths_[word];
+    }
+
+    const std::vector<bool>& code(int32_t word) const {
+        return codes_[word];
+    }
+
+    /*
+     * Return the number of internal nodes.
+     */
+    int32_t internal_nodes() const;
+};
+
+}
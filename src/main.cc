@@ -2,6 +2,10 @@
 
 #include "minkowski.h"
 #include "args.h"
+#include "pairs.h"
+#include "parameter_server.h"
+#include "vector_delta.h"
+#include "worker.h"
 
 using namespace minkowski;
 
@@ -9,8 +13,25 @@ int main(int argc, char** argv) {
     std::vector<std::string> args(argv, argv + argc);
     std::shared_ptr<Args> a = std::make_shared<Args>();
     a->parse_args(args);
-    Minkowski minkowski(a);
-    minkowski.train();
-    minkowski.save_vectors(a->output);
+    if (a->command == "pairs") {
+        PairAggregator aggregator(a);
+        aggregator.aggregate();
+    } else if (a->command == "sweep") {
+        Minkowski minkowski(a);
+        minkowski.sweep();
+    } else if (a->command == "server") {
+        ParameterServer server(a);
+        server.serve();
+    } else if (a->command == "worker") {
+        Worker worker(a);
+        worker.train();
+    } else if (a->command == "compact") {
+        DeltaCompactor compactor(a);
+        compactor.compact();
+    } else {
+        Minkowski minkowski(a);
+        minkowski.train();
+        minkowski.save_vectors(a->output);
+    }
     return 0;
 }
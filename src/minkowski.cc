@@ -2,6 +2,8 @@
 
 #include <math.h>
 
+#include <cstdio>
+#include <cstring>
 #include <iostream>
 #include <sstream>
 #include <iomanip>
@@ -12,30 +14,94 @@
 #include <algorithm>
 #include <stdexcept>
 #include <numeric>
-#include <random>
 
 // how many tokens to process before reporting on performance
 constexpr int32_t REPORTING_INTERVAL = 50;
+// how many pairs of a pair file are read, and shuffled, at a time
+constexpr int64_t PAIR_BLOCK_SIZE = 10000;
+// tokens per thread in a round of -lock-policy scheduled
+constexpr int64_t SCHEDULE_ROUND_TOKENS = 10000;
+// yields while waiting for a pair of the schedule, before blocking
+constexpr int32_t SCHEDULE_SPINS = 64;
+// rows that -lock-policy scheduled reads from the snapshot of the round when
+// drawn as negatives (with the word ids sorted by frequency, those of the
+// most frequent words)
+constexpr int32_t SCHEDULE_SHARED_ROWS = 64;
+
+constexpr int32_t STATE_MAGIC = 0x4d4b5354; // "MKST"
+constexpr int32_t STATE_VERSION = 1;
 
 namespace minkowski {
 
+/*
+ * Return the offset of the stream, or -1 if it is at its end (as saved in
+ * a ThreadState).
+ */
+static int64_t stream_offset(std::istream& in) {
+    return in.eof() ? -1 : int64_t(in.tellg());
+}
+
+/*
+ * Move the stream to an offset returned by stream_offset.
+ */
+static void seek_offset(std::istream& in, int64_t offset) {
+    in.clear();
+    if (offset < 0) {
+        in.seekg(0, std::ios_base::end);
+        in.peek(); // sets eofbit
+    } else {
+        in.seekg(std::streampos(offset));
+    }
+}
+
+/*
+ * Return the offset of the end of the line of `file` starting at `offset`:
+ * of its newline, or the size of the file.
+ */
+static int64_t line_end(const utils::MappedFile& file, int64_t offset) {
+    const char* newline = static_cast<const char*>(memchr(file.data() + offset, '\n', file.size() - offset));
+    return newline == nullptr ? file.size() : newline - file.data();
+}
+
 Minkowski::Minkowski(std::shared_ptr<Args> args) {
     burnin_ = false;
     args_ = args;
+    scheduled_pairs_ = 0;
+    schedule_round_ = 0;
+    shared_rows_ = 0;
+    schedule_waiters_ = 0;
+    tokens_trained_ = 0;
+    last_checkpoint_tokens_ = 0;
+    deltas_since_full_ = -1;
+    current_epoch_ = 0;
+    resuming_epoch_ = false;
 }
 
 void Minkowski::save_vectors(std::string fn) {
-    std::ofstream ofs(fn + ".csv");
+    write_vectors(fn, *vectors_, args_->threads);
+}
+
+void Minkowski::write_vectors(const std::string& fn, const std::vector<Vector>& vectors, int32_t threads) const {
+    VectorFile::save(fn, dict_->words_, vectors, dict_->nwords_, *args_, threads);
+}
+
+void Minkowski::write_checkpoint(const std::string& fn, const std::vector<Vector>& vectors,
+                                 const std::vector<uint8_t>* changed) {
+    if (!changed) {
+        // on the background thread only, so as not to slow the training threads
+        write_vectors(fn, vectors, 1);
+        last_checkpoint_file_ = fn + (args_->output_format == output_format_name::csv ? ".csv" : ".bin");
+        return;
+    }
+    std::ofstream ofs(fn + ".delta", std::ios::binary);
     if (!ofs.is_open()) {
         throw std::invalid_argument(fn + " cannot be opened for saving vectors!");
     }
-    Vector vec(args_->dimension);
-    for (int32_t i = 0; i < dict_->nwords_; i++) {
-        std::string word = dict_->words_[i].word;
-        vec = vectors_->at(i);
-        ofs << word << " " << vec << std::endl;
-    }
+    // the base by its file name, as it is in the same directory
+    VectorDelta::write(ofs, last_checkpoint_file_.substr(last_checkpoint_file_.find_last_of('/') + 1),
+                       vectors, *changed, dict_->nwords_, args_->dimension);
     ofs.close();
+    last_checkpoint_file_ = fn + ".delta";
 }
 
 void Minkowski::print_info(clock_t start, real progress, int64_t tokens_processed, real lr, real performance) {
@@ -49,124 +115,1242 @@ void Minkowski::print_info(clock_t start, real progress, int64_t tokens_processe
     std::cerr << std::flush;
 }
 
-void Minkowski::skipgram(Model& model, real lr, const std::vector<int32_t>& line, std::minstd_rand& rng) {
+void Minkowski::skipgram(Model& model, Replica& replica, real lr, const std::vector<int32_t>& line, int32_t begin, int32_t end, Rng& rng, LockStats& stats) {
+    PairScratch scratch;
+    int32_t num_negatives = args_->number_negatives;
+    if (burnin_) {
+        num_negatives /= 10;  // as per N&K
+    }
+    for (int32_t w = begin; w < end; w++) {
+        for (int32_t c = -args_->window_size; c <= args_->window_size; c++) {
+            if (c != 0 && w + c >= 0 && w + c < line.size()) {
+                train_pair(model, replica, lr, line[w], line[w + c], num_negatives, scratch, rng, stats);
+            }
+        }
+    }
+    train_deferred(model, replica, lr, num_negatives, scratch, rng, stats);
+}
+
+void Minkowski::train_pairs(Model& model, Replica& replica, real lr, const std::vector<std::pair<int32_t, int32_t>>& pairs, Rng& rng, LockStats& stats) {
+    PairScratch scratch;
+    int32_t num_negatives = args_->number_negatives;
+    if (burnin_) {
+        num_negatives /= 10;  // as per N&K
+    }
+    for (auto& pair : pairs) {
+        train_pair(model, replica, lr, pair.first, pair.second, num_negatives, scratch, rng, stats);
+    }
+    train_deferred(model, replica, lr, num_negatives, scratch, rng, stats);
+}
+
+void Minkowski::train_pair(Model& model, Replica& replica, real lr, int32_t source, int32_t target, int32_t num_negatives, PairScratch& scratch, Rng& rng, LockStats& stats) {
+    if (source == target) {
+        // a word is never trained against itself
+        return;
+    }
+    if (args_->loss == loss_name::hs) {
+        // the nodes near the root are on most paths, so no pair could be
+        // trained if contended pairs were skipped: the contended nodes of
+        // a pair are trained after the others, or (-lock-policy skip)
+        // left out of it
+        obtain_path(replica, source, target, scratch.samples, scratch.codes, scratch.contended, stats);
+        if (!scratch.samples.empty()) {
+            model.hierarchical_softmax(source, scratch.samples, scratch.codes, lr);
+        }
+        release_samples(replica, scratch.samples);
+        if (!scratch.contended.empty() && args_->lock_policy == lock_policy_name::skip) {
+            stats.nodes_skipped += scratch.contended.size();
+        } else if (!scratch.contended.empty()) {
+            const std::vector<int32_t>& path = tree_->path(target);
+            scratch.samples.clear();
+            scratch.codes.clear();
+            for (auto n : scratch.contended) {
+                // ascending, as the path is, and after the source: no
+                // thread holding a node waits for a lower one
+                replica.flags->at(path[n]).lock();
+                scratch.samples.push_back(path[n]);
+                scratch.codes.push_back(tree_->code(target)[n]);
+            }
+            model.hierarchical_softmax(source, scratch.samples, scratch.codes, lr);
+            release_samples(replica, scratch.samples);
+        }
+        if (!replica.touched.empty()) {
+            replica.touched[source] = 1;
+        }
+        replica.flags->at(source).unlock();
+        stats.pairs_trained++;
+        return;
+    }
+    if (args_->lock_policy == lock_policy_name::sorted) {
+        obtain_vectors_sorted(replica, source, target, scratch.samples, scratch.lock_order, num_negatives, rng, stats);
+    } else if (!obtain_vectors(replica, source, target, scratch.samples, num_negatives, rng, stats)) {
+        // couldn't obtain one of the necessary locks
+        if (args_->lock_policy == lock_policy_name::deferred) {
+            scratch.deferred.push_back(std::make_pair(source, target));
+            stats.pairs_deferred++;
+        } else {
+            stats.pairs_skipped++;
+        }
+        return;
+    }
+    model.log_bilinear_negative_sampling(source, scratch.samples, lr);
+    release_vectors(replica, source, scratch.samples);
+    stats.pairs_trained++;
+}
+
+void Minkowski::train_deferred(Model& model, Replica& replica, real lr, int32_t num_negatives, PairScratch& scratch, Rng& rng, LockStats& stats) {
+    // retry the contended pairs, this time waiting for the locks
+    for (auto& pair : scratch.deferred) {
+        obtain_vectors_sorted(replica, pair.first, pair.second, scratch.samples, scratch.lock_order, num_negatives, rng, stats);
+        model.log_bilinear_negative_sampling(pair.first, scratch.samples, lr);
+        release_vectors(replica, pair.first, scratch.samples);
+        stats.pairs_trained++;
+    }
+    scratch.deferred.clear();
+}
+
+void Minkowski::skipgram_buffered(Model& model, Replica& replica, real lr, const std::vector<int32_t>& line, int32_t begin, int32_t end, Rng& rng, LockStats& stats) {
+    std::vector<std::pair<int32_t, int32_t>> pairs;
+    std::vector<std::pair<int32_t, int32_t>> deferred;
     std::vector<int32_t> samples;
+    std::vector<int32_t> lock_order;
+    int32_t num_negatives = args_->number_negatives;
+    if (burnin_) {
+        num_negatives /= 10;  // as per N&K
+    }
+    for (int32_t first = begin; first < end; first += args_->pair_buffer) {
+        int32_t last = std::min(first + args_->pair_buffer, end);
+        pairs.clear();
+        for (int32_t w = first; w < last; w++) {
+            for (int32_t c = -args_->window_size; c <= args_->window_size; c++) {
+                if (c != 0 && w + c >= 0 && w + c < line.size() && line[w] != line[w + c]) {
+                    pairs.push_back(std::make_pair(line[w], line[w + c]));
+                }
+            }
+        }
+        // group the pairs by source, and visit the rows in ascending order of
+        // word id, so (the ids being sorted by frequency) the frequent rows first
+        std::sort(pairs.begin(), pairs.end());
+        deferred.clear();
+        size_t group = 0;
+        while (group < pairs.size()) {
+            int32_t source = pairs[group].first;
+            size_t group_end = group;
+            while (group_end < pairs.size() && pairs[group_end].first == source) {
+                group_end++;
+            }
+            if (args_->lock_policy == lock_policy_name::sorted) {
+                // the source can't be held across the group, as the lock
+                // order of each pair is ascending
+                for (size_t p = group; p < group_end; p++) {
+                    obtain_vectors_sorted(replica, source, pairs[p].second, samples, lock_order, num_negatives, rng, stats);
+                    std::sort(samples.begin() + 1, samples.end());
+                    model.log_bilinear_negative_sampling(source, samples, lr);
+                    release_vectors(replica, source, samples);
+                    stats.pairs_trained++;
+                }
+            } else if (!replica.flags->at(source).try_lock()) {
+                for (size_t p = group; p < group_end; p++) {
+                    if (args_->lock_policy == lock_policy_name::deferred) {
+                        deferred.push_back(pairs[p]);
+                        stats.pairs_deferred++;
+                    } else {
+                        stats.pairs_skipped++;
+                    }
+                }
+            } else {
+                // the source row is locked once, and stays in cache, for the group
+                for (size_t p = group; p < group_end; p++) {
+                    if (!obtain_samples(replica, source, pairs[p].second, samples, num_negatives, rng, stats)) {
+                        if (args_->lock_policy == lock_policy_name::deferred) {
+                            deferred.push_back(pairs[p]);
+                            stats.pairs_deferred++;
+                        } else {
+                            stats.pairs_skipped++;
+                        }
+                        continue;
+                    }
+                    std::sort(samples.begin() + 1, samples.end());
+                    model.log_bilinear_negative_sampling(source, samples, lr);
+                    release_samples(replica, samples);
+                    stats.pairs_trained++;
+                }
+                if (!replica.touched.empty()) {
+                    replica.touched[source] = 1;
+                }
+                replica.flags->at(source).unlock();
+            }
+            group = group_end;
+        }
+        // retry the contended pairs, this time waiting for the locks
+        for (auto& pair : deferred) {
+            obtain_vectors_sorted(replica, pair.first, pair.second, samples, lock_order, num_negatives, rng, stats);
+            model.log_bilinear_negative_sampling(pair.first, samples, lr);
+            release_vectors(replica, pair.first, samples);
+            stats.pairs_trained++;
+        }
+    }
+}
+
+void Minkowski::cbow(Model& model, Replica& replica, real lr, const std::vector<int32_t>& line, int32_t begin, int32_t end, Rng& rng, LockStats& stats) {
+    std::vector<int32_t> context, samples, lock_order;
     int32_t num_negatives = args_->number_negatives;
     if (burnin_) {
         num_negatives /= 10;  // as per N&K
     }
-    for (int32_t w = 0; w < line.size(); w++) {
+    for (int32_t w = begin; w < end; w++) {
+        int32_t center = line[w];
+        context.clear();
+        for (int32_t c = -args_->window_size; c <= args_->window_size; c++) {
+            if (c != 0 && w + c >= 0 && w + c < line.size() && line[w + c] != center) {
+                context.push_back(line[w + c]);
+            }
+        }
+        if (context.empty()) {
+            continue;
+        }
+        samples.clear();
+        samples.push_back(center);
+        draw_distinct_negatives(context.data(), context.size(), samples, 0, num_negatives, rng, stats);
+        // a context word may occur more than once, but is locked once
+        lock_order.assign(context.begin(), context.end());
+        lock_order.insert(lock_order.end(), samples.begin(), samples.end());
+        std::sort(lock_order.begin(), lock_order.end());
+        lock_order.erase(std::unique(lock_order.begin(), lock_order.end()), lock_order.end());
+        for (auto id : lock_order) {
+            replica.flags->at(id).lock();
+        }
+        model.cbow_negative_sampling(context, samples, lr);
+        for (auto id : lock_order) {
+            if (!replica.touched.empty()) {
+                replica.touched[id] = 1;
+            }
+            replica.flags->at(id).unlock();
+        }
+        stats.pairs_trained++;
+    }
+}
+
+void Minkowski::skipgram_minibatch(Model& model, Replica& replica, real lr, const std::vector<int32_t>& line, int32_t begin, int32_t end, Rng& rng, LockStats& stats) {
+    std::vector<int32_t> inputs, outputs, lock_order;
+    int32_t num_negatives = args_->number_negatives;
+    if (burnin_) {
+        num_negatives /= 10;  // as per N&K
+    }
+    for (int32_t w = begin; w < end; w++) {
+        int32_t center = line[w];
+        inputs.clear();
         for (int32_t c = -args_->window_size; c <= args_->window_size; c++) {
             if (c != 0 && w + c >= 0 && w + c < line.size()) {
-                int32_t source = line[w];
-                int32_t target = line[w + c];
-                if (!obtain_vectors(source, target, samples, num_negatives, rng)) {
-                    // couldn't obtain one of the necessary locks, so skip!
-                    continue;
+                int32_t context = line[w + c];
+                if (context != center && std::find(inputs.begin(), inputs.end(), context) == inputs.end()) {
+                    inputs.push_back(context);
                 }
-                model.log_bilinear_negative_sampling(source, samples, lr);
-                release_vectors(source, samples);
             }
         }
+        if (inputs.empty()) {
+            continue;
+        }
+        outputs.clear();
+        outputs.push_back(center);
+        draw_distinct_negatives(inputs.data(), inputs.size(), outputs, 0, num_negatives, rng, stats);
+        lock_order.assign(inputs.begin(), inputs.end());
+        lock_order.insert(lock_order.end(), outputs.begin(), outputs.end());
+        std::sort(lock_order.begin(), lock_order.end());
+        for (auto id : lock_order) {
+            replica.flags->at(id).lock();
+        }
+        model.minibatch_negative_sampling(inputs, outputs, lr);
+        for (auto id : lock_order) {
+            if (!replica.touched.empty()) {
+                replica.touched[id] = 1;
+            }
+            replica.flags->at(id).unlock();
+        }
+        stats.pairs_trained += inputs.size();
     }
 }
 
-bool Minkowski::obtain_vectors(int32_t source, int32_t target, std::vector<int32_t>& samples, int32_t num_negatives, std::minstd_rand& rng) {
-    if (!vector_flags_->at(source).try_lock()) {
+bool Minkowski::obtain_vectors(Replica& replica, int32_t source, int32_t target, std::vector<int32_t>& samples, int32_t num_negatives, Rng& rng, LockStats& stats) {
+    if (!replica.flags->at(source).try_lock()) {
         return false;
     }
-    if (!vector_flags_->at(target).try_lock()) {
-        vector_flags_->at(source).unlock();
+    if (!obtain_samples(replica, source, target, samples, num_negatives, rng, stats)) {
+        replica.flags->at(source).unlock();
+        return false;
+    }
+    return true;
+}
+
+bool Minkowski::obtain_samples(Replica& replica, int32_t source, int32_t target, std::vector<int32_t>& samples, int32_t num_negatives, Rng& rng, LockStats& stats) {
+    if (!replica.flags->at(target).try_lock()) {
         return false;
     }
     samples.clear();
     samples.push_back(target);
+    // the source and the samples drawn are locked by this thread already, so
+    // are rejected before their locks are tried
+    draw_distinct_negatives(&source, 1, samples, 0, num_negatives, rng, stats, &replica);
+    return true;
+}
 
-    while (samples.size() < num_negatives + 1) {
-        auto next_negative = get_negative_sample(target, rng);
-        if (vector_flags_->at(next_negative).try_lock()) {
-            samples.push_back(next_negative);
+void Minkowski::obtain_vectors_sorted(Replica& replica, int32_t source, int32_t target, std::vector<int32_t>& samples, std::vector<int32_t>& lock_order, int32_t num_negatives, Rng& rng, LockStats& stats) {
+    samples.clear();
+    samples.push_back(target);
+    // the negatives must be distinct from each other and the source
+    draw_distinct_negatives(&source, 1, samples, 0, num_negatives, rng, stats);
+    // locking in ascending order of word id can not deadlock
+    lock_order.assign(samples.begin(), samples.end());
+    lock_order.push_back(source);
+    std::sort(lock_order.begin(), lock_order.end());
+    for (auto id : lock_order) {
+        replica.flags->at(id).lock();
+    }
+}
+
+void Minkowski::obtain_path(Replica& replica, int32_t source, int32_t target, std::vector<int32_t>& samples, std::vector<bool>& codes, std::vector<int32_t>& contended, LockStats& stats) {
+    const std::vector<int32_t>& path = tree_->path(target);
+    const std::vector<bool>& code = tree_->code(target);
+    samples.clear();
+    codes.clear();
+    contended.clear();
+    replica.flags->at(source).lock();
+    for (int32_t n = 0; n < path.size(); n++) {
+        if (replica.flags->at(path[n]).try_lock()) {
+            samples.push_back(path[n]);
+            codes.push_back(code[n]);
+        } else {
+            contended.push_back(n);
         }
     }
-    return true;
+    stats.nodes_contended += contended.size();
 }
 
-int32_t Minkowski::get_negative_sample(int32_t target, std::minstd_rand& rng) {
+int32_t Minkowski::get_negative_sample(int32_t target, Rng& rng) {
     int32_t negative;
     do {
-        negative = negatives_->at(rng() % negatives_->size());
+        negative = negatives_->sample(rng);
     } while (target == negative);
     return negative;
 }
 
-void Minkowski::release_vectors(int32_t source, std::vector<int32_t>& samples) {
+void Minkowski::draw_distinct_negatives(const int32_t* excluded, size_t num_excluded, std::vector<int32_t>& samples, size_t first, int32_t num_negatives, Rng& rng, LockStats& stats, Replica* locking) {
+    const int32_t target = samples[first];
+    const int32_t* excluded_end = excluded + num_excluded;
+    if (num_negatives + 1 + int64_t(num_excluded) > negatives_->size()) {
+        // a small vocabulary: there may be too few words to draw from
+        int32_t available = negatives_->size() - 1;
+        for (const int32_t* word = excluded; word < excluded_end; word++) {
+            if (*word != target && std::find(excluded, word, *word) == word) {
+                available--;
+            }
+        }
+        if (num_negatives > available) {
+            stats.negatives_dropped += num_negatives - std::max(available, 0);
+            num_negatives = std::max(available, 0);
+        }
+    }
+    int32_t failures = 0;
+    while (samples.size() - first < num_negatives + 1) {
+        auto next_negative = get_negative_sample(target, rng);
+        stats.negatives_drawn++;
+        if (std::find(excluded, excluded_end, next_negative) != excluded_end ||
+                std::find(samples.begin() + first, samples.end(), next_negative) != samples.end() ||
+                (locking != nullptr && !locking->flags->at(next_negative).try_lock())) {
+            stats.negatives_rejected++;
+            if (args_->negative_retries >= 0 && ++failures > args_->negative_retries) {
+                // give up, and train with fewer negatives
+                stats.negatives_dropped += num_negatives + 1 - (samples.size() - first);
+                break;
+            }
+            continue;
+        }
+        samples.push_back(next_negative);
+        stats.negatives_log_count += negatives_log_counts_[next_negative];
+    }
+}
+
+void Minkowski::release_vectors(Replica& replica, int32_t source, std::vector<int32_t>& samples) {
+    release_samples(replica, samples);
+    if (!replica.touched.empty()) {
+        replica.touched[source] = 1;
+    }
+    replica.flags->at(source).unlock();
+}
+
+void Minkowski::release_samples(Replica& replica, std::vector<int32_t>& samples) {
     for (int32_t n = 0; n < samples.size(); n++) {
-        vector_flags_->at(samples[n]).unlock();
+        if (!replica.touched.empty()) {
+            // safe, since the lock is still held
+            replica.touched[samples[n]] = 1;
+        }
+        replica.flags->at(samples[n]).unlock();
     }
-    vector_flags_->at(source).unlock();
 }
 
-void Minkowski::epoch_thread(int32_t thread_id, int32_t seed, real start_lr, real end_lr) {
-    std::minstd_rand rng(seed);
-    std::ifstream ifs(args_->input);
+void Minkowski::create_replicas() {
+    replicas_.clear();
+    replicas_.push_back(Replica{vectors_, vector_flags_, std::vector<uint8_t>()});
+    for (int32_t r = 1; r < args_->replicas; r++) {
+        Replica replica;
+        replica.vectors = std::make_shared<std::vector<Vector>>(*vectors_);
+        replica.flags = std::shared_ptr<std::vector<std::mutex>>(new std::vector<std::mutex>(vectors_->size()));
+        replicas_.push_back(replica);
+    }
+    if (args_->replicas > 1) {
+        for (auto& replica : replicas_) {
+            replica.touched.assign(vectors_->size(), 0);
+        }
+    }
+    merge_barrier_ = std::make_shared<utils::Barrier>(args_->threads);
+}
+
+void Minkowski::merge_replicas(int64_t begin, int64_t end) {
+    Vector centroid(args_->dimension);
+    std::vector<const Vector*> copies;
+    for (int64_t i = begin; i < end; i++) {
+        bool touched = false;
+        for (auto& replica : replicas_) {
+            touched = touched || replica.touched[i];
+        }
+        if (!touched) {
+            continue;
+        }
+        copies.clear();
+        for (auto& replica : replicas_) {
+            copies.push_back(&replica.vectors->at(i));
+        }
+        lorentzian_centroid(copies, centroid);
+        // a checkpoint may be copying the rows of the first replica meanwhile
+        std::lock_guard<std::mutex> lock(replicas_[0].flags->at(i));
+        for (auto& replica : replicas_) {
+            replica.vectors->at(i) = centroid;
+            replica.touched[i] = 0;
+        }
+        if (dirty_rows_) {
+            (*dirty_rows_)[i] = 1;
+        }
+    }
+}
+
+void Minkowski::pairs_epoch_thread(int32_t thread_id, int32_t seed, int32_t epoch, real start_lr, real end_lr) {
+    Rng rng(seed + epoch * args_->threads + thread_id);
+    std::ifstream ifs(args_->input, std::ios::binary);
+    Replica& replica = replicas_[0];
+    Model model(replica.vectors, args_);
+    model.track_dirty(dirty_rows_);
+
+    // this thread's share of the pairs
+    const int64_t first = thread_id * pair_file_->num_pairs / args_->threads;
+    const int64_t last = (thread_id + 1) * pair_file_->num_pairs / args_->threads;
+    // each pair is trained weight * rate times in expectation, so that an
+    // epoch trains as many pairs as there are in the file
+    const double rate = pair_file_->num_pairs / pair_file_->total_weight;
+    std::vector<WeightedPair> block;
+    std::vector<std::pair<int32_t, int32_t>> pairs;
+    LockStats stats;
+    clock_t start = clock();
+    real lr = start_lr;
+    real progress = 0.;
+    int64_t pairs_trained = 0;
+    for (int64_t begin = first; begin < last; begin += PAIR_BLOCK_SIZE) {
+        int64_t count = std::min(PAIR_BLOCK_SIZE, last - begin);
+        pair_file_->read(ifs, begin, count, block);
+        pairs.clear();
+        for (auto& pair : block) {
+            double repeats = pair.weight * rate;
+            int64_t times = int64_t(repeats);
+            if (rng.uniform() < repeats - times) {
+                times++;
+            }
+            for (int64_t i = 0; i < times; i++) {
+                pairs.push_back(std::make_pair(pair.source, pair.target));
+            }
+        }
+        std::shuffle(pairs.begin(), pairs.end(), rng);
+        train_pairs(model, replica, lr, pairs, rng, stats);
+        pairs_trained += pairs.size();
+        progress = real(begin + count - first) / (last - first);
+        lr = start_lr * (1.0 - progress) + end_lr * progress;
+        if (thread_id == 0) {
+            // the throughput is reported in pairs, rather than words
+            print_info(start, progress, pairs_trained, lr, model.get_performance());
+            maybe_checkpoint(pairs_trained);
+        }
+    }
+    if (thread_id == 0) {
+        std::cerr << std::endl;
+    }
+    std::lock_guard<std::mutex> lock(lock_stats_mutex_);
+    lock_stats_.add(stats);
+}
+
+void Minkowski::scheduled_epoch_thread(int32_t thread_id, int32_t seed, int32_t epoch, real start_lr, real end_lr) {
+    Philox subsampling_rng(seed, epoch);
+    std::unique_ptr<std::istream> input = open_input();
+    std::istream& ifs = *input;
     utils::seek(ifs, thread_id * utils::size(ifs) / args_->threads);
     Model model(vectors_, args_);
+    model.track_dirty(dirty_rows_);
+    ScheduledPairs& pairs = schedule_[thread_id];
+    int32_t num_negatives = args_->number_negatives;
+    if (burnin_) {
+        num_negatives /= 10;  // as per N&K
+    }
+
+    // all threads take part in the same number of rounds
+    const int64_t max_tokens = train_tokens_ / args_->threads;
+    const int64_t num_rounds = (max_tokens + SCHEDULE_ROUND_TOKENS - 1) / SCHEDULE_ROUND_TOKENS;
+    int64_t token_count = 0;
+    std::vector<int32_t> line;
+    LinePosition position;
+    uint32_t rand[4];
+    LockStats stats;
+    // the training state is saved every state_rounds rounds, within the epoch
+    const int64_t state_rounds = std::max(args_->state_tokens / args_->threads / SCHEDULE_ROUND_TOKENS, int64_t(1));
+    int64_t first_round = 0;
+    if (resuming_epoch_) {
+        const ThreadState& state = thread_states_[thread_id];
+        seek_offset(ifs, state.offset);
+        position = state.position;
+        line = state.line;
+        token_count = state.token_count;
+        first_round = state.round;
+        model.set_performance_sums(state.performance, state.nexamples);
+        stats = state.stats;
+    }
+    clock_t start = clock();
+    real lr = start_lr;
+    real progress = 0.;
+    for (int64_t round = first_round; round < num_rounds; round++) {
+        pairs.clear();
+        const int64_t round_tokens = std::min((round + 1) * SCHEDULE_ROUND_TOKENS, max_tokens);
+        while (token_count < round_tokens) {
+            int32_t ntokens = dict_->get_chunk(ifs, line, subsampling_rng, position);
+            token_count += ntokens;
+            progress = std::min(1.0, real(token_count) / max_tokens);
+            lr = start_lr * (1.0 - progress) + end_lr * progress;
+            // the negatives of a chunk are drawn from a seed given by its
+            // position (counters that subsampling never reaches)
+            subsampling_rng.block(position.line_offset, UINT64_MAX - (position.token_index - ntokens), rand);
+            Rng rng((uint64_t(rand[0]) << 32) | rand[1]);
+            schedule_line(line, position.begin, position.end, lr, num_negatives, rng, pairs, stats);
+        }
+        merge_barrier_->wait();
+        // counted while the other threads wait: they clear their pairs for
+        // the next round once they have flushed this one
+        int64_t round_pairs = 0;
+        if (thread_id == 0) {
+            schedule_round_++;
+            for (auto& thread_pairs : schedule_) {
+                round_pairs += thread_pairs.size();
+            }
+            if (pair_done_.size() < round_pairs) {
+                pair_done_ = std::vector<std::atomic<int64_t>>(round_pairs);
+            }
+            // between rounds, so that the snapshot is that of the last round
+            maybe_checkpoint(token_count);
+        }
+        position_schedule(thread_id);
+        merge_barrier_->wait();
+        order_schedule(thread_id);
+        merge_barrier_->wait();
+        apply_schedule(model, pairs, stats);
+        merge_barrier_->wait();
+        flush_shared_rows(thread_id, model);
+        if (thread_id == 0) {
+            scheduled_pairs_ += round_pairs;
+            print_info(start, progress, token_count, lr, model.get_performance());
+        }
+        if (args_->state_tokens > 0 && (round + 1) % state_rounds == 0 && round + 1 < num_rounds) {
+            ThreadState& state = thread_states_[thread_id];
+            state.offset = stream_offset(ifs);
+            state.position = position;
+            state.line = line;
+            state.token_count = token_count;
+            state.round = round + 1;
+            model.get_performance_sums(state.performance, state.nexamples);
+            state.stats = stats;
+            // once all have applied the round
+            merge_barrier_->wait();
+            if (thread_id == 0) {
+                save_state(true);
+            }
+            merge_barrier_->wait();
+        }
+    }
+    if (thread_id == 0) {
+        std::cerr << std::endl;
+    }
+    std::lock_guard<std::mutex> lock(lock_stats_mutex_);
+    lock_stats_.add(stats);
+}
+
+void Minkowski::schedule_line(const std::vector<int32_t>& line, int32_t begin, int32_t end, real lr, int32_t num_negatives, Rng& rng, ScheduledPairs& pairs, LockStats& stats) {
+    for (int32_t w = begin; w < end; w++) {
+        for (int32_t c = -args_->window_size; c <= args_->window_size; c++) {
+            if (c == 0 || w + c < 0 || w + c >= line.size() || line[w] == line[w + c]) {
+                continue;
+            }
+            int32_t source = line[w];
+            int32_t target = line[w + c];
+            pairs.sources.push_back(source);
+            pairs.targets.push_back(target);
+            pairs.lrs.push_back(lr);
+            // distinct negatives, none of them the source
+            size_t first = pairs.samples.size();
+            pairs.samples.push_back(target);
+            draw_distinct_negatives(&source, 1, pairs.samples, first, num_negatives, rng, stats);
+            pairs.sample_begin.push_back(pairs.samples.size());
+        }
+    }
+}
+
+void Minkowski::position_schedule(int32_t thread_id) {
+    ScheduledPairs& pairs = schedule_[thread_id];
+    const int32_t threads = schedule_.size();
+    // the kth pair of thread t is preceded by min(k, n) pairs of each thread
+    // (of n pairs), and by the kth pairs of the threads before t
+    std::vector<int64_t> sizes, sizes_before;
+    for (int32_t t = 0; t < threads; t++) {
+        sizes.push_back(schedule_[t].size());
+        if (t < thread_id) {
+            sizes_before.push_back(schedule_[t].size());
+        }
+    }
+    std::sort(sizes.begin(), sizes.end());
+    std::sort(sizes_before.begin(), sizes_before.end());
+    size_t shorter = 0, shorter_before = 0;  // of sizes at most k
+    int64_t preceding = 0;                   // the sum of min(k, n)
+    pairs.positions.resize(pairs.size());
+    for (size_t k = 0; k < pairs.size(); k++) {
+        while (shorter < sizes.size() && sizes[shorter] <= k) {
+            shorter++;
+        }
+        while (shorter_before < sizes_before.size() && sizes_before[shorter_before] <= k) {
+            shorter_before++;
+        }
+        pairs.positions[k] = preceding + (sizes_before.size() - shorter_before);
+        preceding += sizes.size() - shorter;
+    }
+
+    pairs.dependencies.assign(pairs.size() + pairs.samples.size(), -1);
+    pairs.owned.resize(threads);
+    for (size_t k = 0; k < pairs.size(); k++) {
+        pairs.owned[pairs.sources[k] % threads].push_back(std::make_pair(k, 0));
+        for (int64_t i = pairs.sample_begin[k]; i < pairs.sample_begin[k + 1]; i++) {
+            int32_t row = pairs.samples[i];
+            // the shared rows are read from the snapshot as negatives, and
+            // not ordered
+            if (i == pairs.sample_begin[k] || row >= shared_rows_) {
+                pairs.owned[row % threads].push_back(std::make_pair(k, 1 + i - pairs.sample_begin[k]));
+            }
+        }
+    }
+
+    if (pairs.shared_tangents.size() != shared_rows_) {
+        pairs.shared_tangents.assign(shared_rows_, Vector(args_->dimension));
+    }
+    for (int32_t row = thread_id; row < shared_rows_; row += threads) {
+        shared_snapshot_[row] = vectors_->at(row);
+    }
+}
+
+void Minkowski::order_schedule(int32_t thread_id) {
+    // merge the rows owned by this thread in the order of the round: by k,
+    // then by thread
+    typedef std::pair<int64_t, int32_t> Head;  // (k, thread)
+    std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+    std::vector<size_t> next(schedule_.size(), 0);
+    for (int32_t t = 0; t < schedule_.size(); t++) {
+        if (!schedule_[t].owned[thread_id].empty()) {
+            heads.push(std::make_pair(schedule_[t].owned[thread_id][0].first, t));
+        }
+    }
+    while (!heads.empty()) {
+        int64_t k = heads.top().first;
+        int32_t t = heads.top().second;
+        heads.pop();
+        ScheduledPairs& pairs = schedule_[t];
+        const auto& owned = pairs.owned[thread_id];
+        const int64_t position = scheduled_pairs_ + pairs.positions[k];
+        for (; next[t] < owned.size() && owned[next[t]].first == k; next[t]++) {
+            int32_t n = owned[next[t]].second;
+            int32_t row = n == 0 ? pairs.sources[k] : pairs.samples[pairs.sample_begin[k] + n - 1];
+            // pairs of earlier rounds have all been applied already
+            if (last_update_[row] >= scheduled_pairs_) {
+                pairs.dependencies[k + pairs.sample_begin[k] + n] = last_update_[row] - scheduled_pairs_;
+            }
+            last_update_[row] = position;
+        }
+        if (next[t] < owned.size()) {
+            heads.push(std::make_pair(owned[next[t]].first, t));
+        }
+    }
+}
+
+void Minkowski::apply_schedule(Model& model, ScheduledPairs& pairs, LockStats& stats) {
+    std::vector<int32_t> samples;
+    const int64_t round = schedule_round_;
+    for (size_t k = 0; k < pairs.size(); k++) {
+        for (int64_t i = k + pairs.sample_begin[k]; i < k + 1 + pairs.sample_begin[k + 1]; i++) {
+            if (pairs.dependencies[i] < 0) {
+                continue;
+            }
+            auto& done = pair_done_[pairs.dependencies[i]];
+            for (int32_t spins = 0; done.load(std::memory_order_acquire) != round; spins++) {
+                if (spins < SCHEDULE_SPINS) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                schedule_waiters_++;
+                {
+                    std::unique_lock<std::mutex> lock(schedule_mutex_);
+                    schedule_applied_.wait(lock, [&]() { return done.load() == round; });
+                }
+                schedule_waiters_--;
+            }
+        }
+        samples.assign(pairs.samples.begin() + pairs.sample_begin[k], pairs.samples.begin() + pairs.sample_begin[k + 1]);
+        model.log_bilinear_shared_negatives(pairs.sources[k], samples, shared_rows_, shared_snapshot_,
+                                            pairs.shared_tangents, pairs.lrs[k]);
+        pair_done_[pairs.positions[k]].store(round);
+        // either the waiter sees the pair done, or this sees the waiter
+        if (schedule_waiters_.load() > 0) {
+            std::lock_guard<std::mutex> lock(schedule_mutex_);
+            schedule_applied_.notify_all();
+        }
+        stats.pairs_trained++;
+    }
+}
+
+void Minkowski::flush_shared_rows(int32_t thread_id, Model& model) {
+    Vector tangent(args_->dimension);
+    for (int32_t row = thread_id; row < shared_rows_; row += schedule_.size()) {
+        tangent.zero();
+        for (auto& pairs : schedule_) {
+            tangent.add(pairs.shared_tangents[row]);
+            pairs.shared_tangents[row].zero();
+        }
+        // summed in the order of the threads, so that training is
+        // deterministic; the row may have moved since the snapshot, as a
+        // source or target
+        tangent.project_onto_tangent_space(vectors_->at(row));
+        model.update(row, tangent);
+    }
+}
+
+void Minkowski::epoch_thread(int32_t thread_id, int32_t seed, int32_t epoch, real start_lr, real end_lr) {
+    if (args_->input_format == input_format_name::pairs) {
+        pairs_epoch_thread(thread_id, seed, epoch, start_lr, end_lr);
+        return;
+    }
+    if (args_->lock_policy == lock_policy_name::scheduled) {
+        scheduled_epoch_thread(thread_id, seed, epoch, start_lr, end_lr);
+        return;
+    }
+    Rng rng(seed + epoch * args_->threads + thread_id);
+    Philox subsampling_rng(seed, epoch);
+    std::unique_ptr<std::istream> input = open_input();
+    std::istream& ifs = *input;
+    utils::seek(ifs, thread_id * utils::size(ifs) / args_->threads);
+    // consecutive threads (so adjacent parts of the corpus) share a replica
+    Replica& replica = replicas_[int64_t(thread_id) * args_->replicas / args_->threads];
+    Model model(replica.vectors, args_);
+    if (&replica == &replicas_[0]) {
+        // only the first replica is checkpointed
+        model.track_dirty(dirty_rows_);
+    }
 
     // number of tokens that this thread should process
-    const int64_t max_tokens = dict_->ntokens_ / args_->threads;
+    const int64_t max_tokens = train_tokens_ / args_->threads;
     int64_t token_count = 0; // number processed so far
+    // the replicas are merged every sync_tokens tokens processed per thread
+    const int64_t sync_tokens = std::max(int64_t(args_->sync_interval) / args_->threads, int64_t(1));
+    const int64_t num_syncs = args_->replicas > 1 ? max_tokens / sync_tokens : 0;
+    int64_t syncs_done = 0;
+    // the training state is saved every state_tokens tokens processed per
+    // thread, within the epoch
+    const int64_t state_tokens = std::max(args_->state_tokens / args_->threads, int64_t(1));
+    const int64_t num_states = args_->state_tokens > 0 ? (max_tokens - 1) / state_tokens : 0;
+    int64_t states_done = 0;
+    const int64_t rows = vectors_->size();
     int64_t iter_count = 0;
     std::vector<int32_t> line;
+    LinePosition position;
+    LockStats stats;
+    if (resuming_epoch_) {
+        const ThreadState& state = thread_states_[thread_id];
+        seek_offset(ifs, state.offset);
+        position = state.position;
+        line = state.line;
+        token_count = state.token_count;
+        iter_count = state.iter_count;
+        syncs_done = state.syncs_done;
+        states_done = state.states_done;
+        rng = state.rng;
+        model.set_performance_sums(state.performance, state.nexamples);
+        stats = state.stats;
+    }
     clock_t start = clock();
     real lr = start_lr;
     real progress = 0.;
     while (token_count < max_tokens) {
-        token_count += dict_->get_line(ifs, line, rng);
+        token_count += dict_->get_chunk(ifs, line, subsampling_rng, position);
         progress = std::min(1.0, real(token_count) / max_tokens);
         lr = start_lr * (1.0 - progress) + end_lr * progress;
-        skipgram(model, lr, line, rng);
+        int32_t begin = position.begin;
+        int32_t end = position.end;
+        if (args_->model == model_name::cbow) {
+            cbow(model, replica, lr, line, begin, end, rng, stats);
+        } else if (args_->engine == engine_name::minibatch) {
+            skipgram_minibatch(model, replica, lr, line, begin, end, rng, stats);
+        } else if (args_->pair_buffer > 0 && args_->loss == loss_name::ns) {
+            skipgram_buffered(model, replica, lr, line, begin, end, rng, stats);
+        } else {
+            skipgram(model, replica, lr, line, begin, end, rng, stats);
+        }
         if (thread_id == 0) {
             // only thread 0 is responsible for printing progress info
             if (iter_count % REPORTING_INTERVAL == 0) {
                 print_info(start, progress, token_count, lr, model.get_performance());
+                maybe_checkpoint(token_count);
             }
         }
         iter_count++;
+        // the merges and the saves of the state, in the same order in all threads
+        while (true) {
+            int64_t next_sync = syncs_done < num_syncs ? (syncs_done + 1) * sync_tokens : INT64_MAX;
+            int64_t next_state = states_done < num_states ? (states_done + 1) * state_tokens : INT64_MAX;
+            if (std::min(next_sync, next_state) > token_count) {
+                break;
+            }
+            if (next_sync <= next_state) {
+                // all threads merge their share of the rows, once all have arrived
+                merge_barrier_->wait();
+                merge_replicas(thread_id * rows / args_->threads, (thread_id + 1) * rows / args_->threads);
+                merge_barrier_->wait();
+                syncs_done++;
+            } else {
+                states_done++;
+                ThreadState& state = thread_states_[thread_id];
+                state.offset = stream_offset(ifs);
+                state.position = position;
+                state.line = line;
+                state.token_count = token_count;
+                state.iter_count = iter_count;
+                state.syncs_done = syncs_done;
+                state.states_done = states_done;
+                state.rng = rng;
+                model.get_performance_sums(state.performance, state.nexamples);
+                state.stats = stats;
+                merge_barrier_->wait();
+                if (thread_id == 0) {
+                    save_state(true);
+                }
+                merge_barrier_->wait();
+            }
+        }
     }
     if (thread_id == 0) {
         print_info(start, progress, token_count, lr, model.get_performance());
         std::cerr << std::endl;
     }
-    ifs.close();
+    std::lock_guard<std::mutex> lock(lock_stats_mutex_);
+    lock_stats_.add(stats);
 }
 
-void Minkowski::train() {
+void Minkowski::build_vocabulary() {
+    if (!args_->resume.empty()) {
+        read_state();
+        dict_ = std::make_shared<Dictionary>(args_);
+        const std::string& vocabulary = resume_state_->vocabulary;
+        dict_->restore_vocabulary(vocabulary.data(), vocabulary.data() + vocabulary.size());
+        std::cerr << "Number of words:  " << dict_->nwords_ << std::endl;
+        if (args_->input_format == input_format_name::pairs) {
+            pair_file_ = std::make_shared<PairFile>(args_->input);
+        }
+        generate_negative_samples(dict_->get_counts());
+        train_input_ = args_->input;
+        train_tokens_ = resume_state_->train_tokens;
+        if (!args_->replay.empty()) {
+            // as mixed by the run that saved the state
+            train_input_ = args_->output + ".replay.txt";
+            mix_replay(train_input_);
+        }
+        return;
+    }
+    if (args_->input_format == input_format_name::pairs) {
+        // the vocabulary is stored with the pairs
+        pair_file_ = std::make_shared<PairFile>(args_->input);
+        dict_ = std::make_shared<Dictionary>(args_);
+        dict_->set_vocabulary(pair_file_->words);
+        std::cerr << "Number of words:  " << dict_->nwords_ << std::endl;
+        std::cerr << "Number of pairs:  " << pair_file_->num_pairs << std::endl;
+        generate_negative_samples(dict_->get_counts());
+        return;
+    } else if (args_->input_format != input_format_name::text) {
+        throw std::invalid_argument("An edge list must be converted with the pairs command first.");
+    }
     std::ifstream ifs(args_->input);
     if (!ifs.is_open()) {
         throw std::invalid_argument(
                     args_->input + " cannot be opened for training!");
     }
     dict_ = std::make_shared<Dictionary>(args_);
-    dict_->determine_vocabulary(ifs);
+    if (!args_->read_vocab.empty()) {
+        {
+            utils::MappedFile vocab(args_->read_vocab);
+            dict_->read_vocabulary(vocab.data(), vocab.data() + vocab.size());
+        }
+        if (args_->grow_vocab) {
+            dict_->update_vocabulary(ifs);
+        }
+    } else {
+        utils::MappedFile corpus(args_->input);
+        dict_->determine_vocabulary(corpus.data(), corpus.data() + corpus.size());
+    }
     ifs.close();
+    if (!args_->save_vocab.empty()) {
+        std::ofstream vocab(args_->save_vocab, std::ios::binary);
+        if (!vocab.is_open()) {
+            throw std::invalid_argument(args_->save_vocab + " cannot be opened for saving the vocabulary!");
+        }
+        dict_->save_vocabulary(vocab);
+    }
     // generate the negative samples
-    negatives_ = std::make_shared<std::vector<int32_t>>();
     generate_negative_samples(dict_->get_counts());
+
+    train_input_ = args_->input;
+    train_tokens_ = dict_->ntokens_;
+    if (!args_->replay.empty()) {
+        train_input_ = args_->output + ".replay.txt";
+        mix_replay(train_input_);
+    }
+    if ((!args_->read_vocab.empty() && args_->grow_vocab) || !args_->replay.empty()) {
+        // the input is only a part of the tokens counted by the vocabulary
+        std::unique_ptr<std::istream> train_ifs = open_input();
+        Philox rng(0, 0);
+        std::vector<int32_t> line;
+        LinePosition position;
+        train_tokens_ = 0;
+        while (train_ifs->peek() != EOF) {
+            train_tokens_ += dict_->get_chunk(*train_ifs, line, rng, position);
+        }
+    }
+}
+
+void Minkowski::mix_replay(const std::string& path) {
+    utils::MappedFile input(args_->input);
+    std::unique_ptr<utils::MappedFile> replay;
+    try {
+        replay.reset(new utils::MappedFile(args_->replay));
+    } catch (const std::invalid_argument&) {
+        throw std::invalid_argument(args_->replay + " cannot be opened for replay!");
+    }
+    // the lines are shuffled as their offsets (those of -replay as -1 - the
+    // offset), and copied from the mapped files, rather than read in
+    std::vector<int64_t> lines;
+    for (int64_t offset = 0; offset < input.size(); offset = line_end(input, offset) + 1) {
+        lines.push_back(offset);
+    }
+    int64_t new_lines = lines.size();
+    Rng rng(args_->seed);
+    for (int64_t offset = 0; offset < replay->size(); offset = line_end(*replay, offset) + 1) {
+        if (rng.uniform() < args_->replay_fraction) {
+            lines.push_back(-1 - offset);
+        }
+    }
+    std::cerr << "Replaying " << lines.size() - new_lines << " lines of " << args_->replay << std::endl;
+    std::shuffle(lines.begin(), lines.end(), rng);
+    std::ofstream ofs(path);
+    if (!ofs.is_open()) {
+        throw std::invalid_argument(path + " cannot be opened for writing!");
+    }
+    for (auto offset : lines) {
+        const utils::MappedFile& file = offset < 0 ? *replay : input;
+        if (offset < 0) {
+            offset = -1 - offset;
+        }
+        ofs.write(file.data() + offset, line_end(file, offset) - offset);
+        ofs << "\n";
+    }
+}
+
+std::unique_ptr<std::istream> Minkowski::open_input() const {
+    if (corpus_) {
+        return std::unique_ptr<std::istream>(
+                new utils::MemoryStream(corpus_->data(), corpus_->data() + corpus_->size()));
+    }
+    return std::unique_ptr<std::istream>(new std::ifstream(train_input_));
+}
+
+void Minkowski::train() {
+    build_vocabulary();
+    train_vectors();
+    if (!args_->replay.empty()) {
+        std::remove(train_input_.c_str());
+    }
+}
+
+void Minkowski::sweep() {
+    std::vector<std::string> lrs, dimensions;
+    std::stringstream lr_list(args_->sweep_lr), dimension_list(args_->sweep_dimension);
+    std::string value;
+    while (std::getline(lr_list, value, ',')) {
+        if (!value.empty()) {
+            lrs.push_back(value);
+        }
+    }
+    while (std::getline(dimension_list, value, ',')) {
+        if (!value.empty()) {
+            dimensions.push_back(value);
+        }
+    }
+    if (lrs.empty() || dimensions.empty()) {
+        throw std::invalid_argument("A sweep needs -sweep-lr and -sweep-dimension.");
+    }
+    if (!args_->resume.empty()) {
+        throw std::invalid_argument("A sweep can not be resumed.");
+    }
+    build_vocabulary();
+    if (args_->input_format == input_format_name::text) {
+        corpus_ = std::make_shared<utils::MappedFile>(train_input_);
+    }
+    int32_t num_configs = lrs.size() * dimensions.size();
+    int32_t config_index = 0;
+    for (auto& dimension : dimensions) {
+        for (auto& lr : lrs) {
+            auto config = std::make_shared<Args>(*args_);
+            config->dimension = std::stoi(dimension);
+            config->start_lr = std::stof(lr);
+            config->end_lr = args_->end_lr * config->start_lr / args_->start_lr;
+            // as are its checkpoints
+            config->output = args_->output + "-dim-" + dimension + "-lr-" + lr;
+            std::cerr << "Configuration " << ++config_index << " / " << num_configs
+                      << ": dimension " << dimension << ", lr " << lr << std::endl;
+            Minkowski model(config);
+            model.dict_ = dict_;
+            model.train_input_ = train_input_;
+            model.train_tokens_ = train_tokens_;
+            model.corpus_ = corpus_;
+            model.negatives_ = negatives_;
+            model.negatives_log_counts_ = negatives_log_counts_;
+            model.expected_negatives_log_count_ = expected_negatives_log_count_;
+            model.pair_file_ = pair_file_;
+            model.train_vectors();
+            model.save_vectors(config->output);
+        }
+    }
+    corpus_.reset();
+    if (!args_->replay.empty()) {
+        std::remove(train_input_.c_str());
+    }
+}
+
+void Minkowski::train_vectors() {
     // initialise the vectors
-    std::minstd_rand rng(args_->seed);
+    Rng rng(args_->seed);
     Vector init_vector(args_->dimension);
     vectors_ = std::make_shared<std::vector<Vector>>();
     for (int64_t i=0; i < dict_->nwords_; i++) {
         random_hyperboloid_point(init_vector, rng, args_->init_std_dev);
         vectors_->push_back(init_vector);
     }
+    if (!args_->init_vectors.empty() && !resume_state_) {
+        load_init_vectors(rng);
+    }
+    if (args_->loss == loss_name::hs) {
+        if (args_->model != model_name::skipgram || args_->engine != engine_name::pair) {
+            throw std::invalid_argument("-loss hs requires -model skipgram and -engine pair.");
+        }
+        if (!args_->read_vocab.empty() && args_->grow_vocab) {
+            // the Huffman tree needs the ids in order of count
+            throw std::invalid_argument("-loss hs can not be combined with -grow-vocab.");
+        }
+        // the internal nodes start at the base point, as the output vectors
+        // of fastText start at zero
+        tree_ = std::make_shared<HuffmanTree>(dict_->get_counts());
+        init_vector.zero();
+        init_vector[args_->dimension - 1] = 1.;
+        for (int32_t i = 0; i < tree_->internal_nodes(); i++) {
+            vectors_->push_back(init_vector);
+        }
+    }
     vector_flags_ = std::shared_ptr<std::vector<std::mutex>>(new std::vector<std::mutex>(vectors_->size()));
+    if (args_->replicas < 1 || args_->replicas > args_->threads) {
+        throw std::invalid_argument("-replicas must be between 1 and the number of threads.");
+    }
+    if (args_->input_format == input_format_name::pairs &&
+            (args_->replicas != 1 || args_->model != model_name::skipgram)) {
+        throw std::invalid_argument("A pair file is trained with -model skipgram and a single replica.");
+    }
+    if (args_->lock_policy == lock_policy_name::scheduled) {
+        // with -loss hs, every pair would wait for the last on the root
+        if (args_->replicas != 1 || args_->model != model_name::skipgram || args_->engine != engine_name::pair ||
+                args_->loss != loss_name::ns || args_->input_format != input_format_name::text) {
+            throw std::invalid_argument("-lock-policy scheduled trains -model skipgram with -engine pair and -loss ns, on a corpus, with a single replica.");
+        }
+        schedule_.assign(args_->threads, ScheduledPairs());
+        last_update_.assign(vectors_->size(), -1);
+        shared_rows_ = std::min(SCHEDULE_SHARED_ROWS, int32_t(vectors_->size()));
+        shared_snapshot_.assign(shared_rows_, Vector(args_->dimension));
+    }
+    create_replicas();
+    thread_states_.assign(args_->threads, ThreadState());
+    int32_t first_burnin_epoch = 0, first_epoch = 0;
+    if (resume_state_) {
+        restore_state();
+        if (resume_state_->burnin) {
+            first_burnin_epoch = resume_state_->epoch;
+        } else {
+            first_burnin_epoch = args_->burnin_epochs;
+            first_epoch = resume_state_->epoch;
+        }
+        resume_state_.reset();
+    }
+    if (args_->checkpoint_interval > 0 || args_->checkpoint_tokens > 0 || args_->checkpoint_seconds > 0) {
+        // of replica 0, with -replicas; all rows are copied for the first
+        dirty_rows_ = std::make_shared<std::vector<uint8_t>>(vectors_->size(), 1);
+        deltas_since_full_ = -1;
+        checkpointer_.reset(new Checkpointer(vectors_, vector_flags_, dirty_rows_, dict_->nwords_,
+                                             [this](const std::string& fn, const std::vector<Vector>& vectors,
+                                                    const std::vector<uint8_t>* changed) {
+                                                 write_checkpoint(fn, vectors, changed);
+                                             }));
+        last_checkpoint_time_ = std::chrono::steady_clock::now();
+    }
     // do any burn-in epochs
     burnin_ = true;
-    train_epochs(args_->burnin_epochs, args_->seed, args_->burnin_lr, args_->burnin_lr, false);
+    train_epochs(args_->burnin_epochs, args_->seed, args_->burnin_lr, args_->burnin_lr, false, first_burnin_epoch);
     burnin_ = false;
     // do the epochs: use a different seed to ensure different negative samples
-    train_epochs(args_->epochs, -1 * (args_->seed), args_->start_lr, args_->end_lr, true);
+    train_epochs(args_->epochs, -1 * (args_->seed), args_->start_lr, args_->end_lr, true, first_epoch);
+    if (checkpointer_) {
+        checkpointer_->finish();
+        checkpointer_->print_stats();
+        checkpointer_.reset();
+        dirty_rows_.reset();
+    }
+}
+
+void Minkowski::load_init_vectors(Rng& rng) {
+    std::vector<uint8_t> loaded(dict_->nwords_, 0);
+    int64_t num_loaded = 0;
+    // once the vector of the word with the given id has been read
+    auto load = [&](const std::string& word, int32_t id) {
+        Vector& vector = vectors_->at(id);
+        // time-like and on the upper sheet, where the training keeps the vectors
+        if (minkowski_dot(vector, vector) >= 0 || !(vector[args_->dimension - 1] > 0)) {
+            throw std::invalid_argument("The vector of " + word + " in " + args_->init_vectors +
+                                        " is not on the hyperboloid.");
+        }
+        vector.ensure_on_hyperboloid();
+        loaded[id] = 1;
+        num_loaded++;
+    };
+    const std::string dimension_error = args_->init_vectors + " does not have vectors of dimension " +
+                                        std::to_string(args_->dimension) + ".";
+    utils::MappedFile file(args_->init_vectors);
+    if (VectorFile::is_vector_file(file.data(), file.data() + file.size())) {
+        VectorFile vectors(file.data(), file.data() + file.size());
+        if (vectors.dimension() != args_->dimension) {
+            throw std::invalid_argument(dimension_error);
+        }
+        for (int64_t row = 0; row < vectors.count(); row++) {
+            std::string word = vectors.word(row);
+            int32_t id = dict_->get_id(word);
+            if (id < 0) {
+                continue; // no longer in the vocabulary
+            }
+            std::copy(vectors.vector(row), vectors.vector(row) + args_->dimension, vectors_->at(id).data_);
+            load(word, id);
+        }
+    } else {
+        utils::MemoryStream ifs(file.data(), file.data() + file.size());
+        std::string line, word;
+        while (std::getline(ifs, line)) {
+            std::istringstream fields(line);
+            if (!(fields >> word)) {
+                continue;
+            }
+            int32_t id = dict_->get_id(word);
+            if (id < 0) {
+                continue; // no longer in the vocabulary
+            }
+            Vector& vector = vectors_->at(id);
+            for (int32_t i = 0; i < args_->dimension; i++) {
+                if (!(fields >> vector[i])) {
+                    throw std::invalid_argument(dimension_error);
+                }
+            }
+            fields >> std::ws; // no more fields than coordinates
+            if (!fields.eof()) {
+                throw std::invalid_argument(dimension_error);
+            }
+            load(word, id);
+        }
+    }
+
+    // sum the loaded vectors in the context of each of the other words
+    std::vector<int32_t> unseen_index(dict_->nwords_, -1);
+    int32_t num_unseen = 0;
+    for (int32_t i = 0; i < dict_->nwords_; i++) {
+        if (!loaded[i]) {
+            unseen_index[i] = num_unseen++;
+        }
+    }
+    std::vector<real> sums(int64_t(num_unseen) * args_->dimension, 0.);
+    std::vector<uint8_t> has_neighbours(num_unseen, 0);
+    if (num_unseen > 0 && num_loaded > 0 && args_->input_format == input_format_name::text) {
+        std::unique_ptr<std::istream> corpus = open_input();
+        Philox subsampling_rng(args_->seed, 0);
+        std::vector<int32_t> words;
+        LinePosition position;
+        while (corpus->peek() != EOF) {
+            dict_->get_chunk(*corpus, words, subsampling_rng, position);
+            for (int32_t w = position.begin; w < position.end; w++) {
+                int32_t index = unseen_index[words[w]];
+                if (index < 0) {
+                    continue;
+                }
+                real* sum = &sums[int64_t(index) * args_->dimension];
+                for (int32_t c = -args_->window_size; c <= args_->window_size; c++) {
+                    if (c != 0 && w + c >= 0 && w + c < words.size() && loaded[words[w + c]]) {
+                        const Vector& neighbour = vectors_->at(words[w + c]);
+                        for (int32_t i = 0; i < args_->dimension; i++) {
+                            sum[i] += neighbour[i];
+                        }
+                        has_neighbours[index] = 1;
+                    }
+                }
+            }
+        }
+    }
+    int64_t num_placed = 0;
+    Vector tangent(args_->dimension);
+    for (int32_t id = 0; id < dict_->nwords_; id++) {
+        int32_t index = unseen_index[id];
+        if (index < 0 || !has_neighbours[index]) {
+            continue;
+        }
+        Vector& vector = vectors_->at(id);
+        std::copy(&sums[int64_t(index) * args_->dimension], &sums[int64_t(index + 1) * args_->dimension], vector.data_);
+        vector.ensure_on_hyperboloid();
+        for (int32_t i = 0; i < args_->dimension; i++) {
+            tangent[i] = rng.normal(args_->init_std_dev);
+        }
+        tangent.project_onto_tangent_space(vector);
+        real step_size = std::sqrt(minkowski_dot(tangent, tangent));
+        if (step_size > 0) {
+            tangent.multiply(1.0 / step_size);
+            vector.geodesic_update(tangent, step_size);
+        }
+        num_placed++;
+    }
+    std::cerr << "Loaded " << num_loaded << " vectors from " << args_->init_vectors << "; "
+              << num_placed << " new words placed among their neighbours, "
+              << num_unseen - num_placed << " at random" << std::endl;
 }
 
 void Minkowski::save_checkpoint(int32_t epochs_trained) {
@@ -175,30 +1359,236 @@ void Minkowski::save_checkpoint(int32_t epochs_trained) {
         // alphabetical ordering
         std::string epochs_done = std::to_string(epochs_trained);
         epochs_done = std::string(6 - epochs_done.length(), '0') + epochs_done;
-        this->save_vectors(args_->output + "-after-" + epochs_done + "-epochs");
+        // copied now, between epochs, and written while the next is trained
+        checkpointer_->request(args_->output + "-after-" + epochs_done + "-epochs", true, true);
+        deltas_since_full_ = 0;
+    }
+}
+
+void Minkowski::maybe_checkpoint(int64_t thread_tokens) {
+    if (!checkpointer_ || (args_->checkpoint_tokens <= 0 && args_->checkpoint_seconds <= 0)) {
+        return;
+    }
+    // the threads progress at about the same rate
+    const int64_t tokens = tokens_trained_ + thread_tokens * args_->threads;
+    auto now = std::chrono::steady_clock::now();
+    if ((args_->checkpoint_tokens <= 0 || tokens - last_checkpoint_tokens_ < args_->checkpoint_tokens) &&
+            (args_->checkpoint_seconds <= 0 || now - last_checkpoint_time_ < std::chrono::seconds(args_->checkpoint_seconds))) {
+        return;
+    }
+    last_checkpoint_tokens_ = tokens;
+    last_checkpoint_time_ = now;
+    std::string tokens_done = std::to_string(tokens);
+    tokens_done = std::string(std::max(12 - int32_t(tokens_done.length()), 0), '0') + tokens_done;
+    // deltas of the rows changed since the previous checkpoint, between full ones
+    bool delta = deltas_since_full_ >= 0 && deltas_since_full_ < args_->checkpoint_deltas;
+    if (checkpointer_->request(args_->output + "-after-" + tokens_done + "-tokens", false,
+                               args_->lock_policy == lock_policy_name::scheduled, delta)) {
+        deltas_since_full_ = delta ? deltas_since_full_ + 1 : 0;
+    }
+}
+
+/*
+ * The options that the training state depends on, which must be the same to
+ * resume from it.
+ */
+static std::vector<double> state_options(const Args& args) {
+    return {double(args.dimension), double(args.threads), double(args.replicas), double(args.sync_interval),
+            double(int(args.lock_policy)), double(int(args.input_format)), double(int(args.model)),
+            double(int(args.loss)), double(int(args.engine)), double(args.pair_buffer),
+            double(args.negative_retries), double(args.window_size), double(args.number_negatives),
+            double(args.epochs), double(args.burnin_epochs), double(args.seed), args.t, args.start_lr,
+            args.end_lr, args.burnin_lr, args.max_step_size, args.distribution_power};
+}
+
+void Minkowski::save_state(bool mid_epoch) {
+    const std::string path = args_->output + ".state";
+    std::ofstream out(path + ".tmp", std::ios::binary);
+    if (!out.is_open()) {
+        std::cerr << path << ".tmp cannot be opened for saving the training state!" << std::endl;
+        return;
+    }
+    utils::write_value(out, STATE_MAGIC);
+    utils::write_value(out, STATE_VERSION);
+    std::vector<double> options = state_options(*args_);
+    utils::write_value(out, int64_t(options.size()));
+    out.write(reinterpret_cast<const char*>(options.data()), options.size() * sizeof(double));
+    utils::write_value(out, int32_t(burnin_.load()));
+    utils::write_value(out, int32_t(mid_epoch ? current_epoch_ : current_epoch_ + 1));
+    utils::write_value(out, tokens_trained_);
+    utils::write_value(out, train_tokens_);
+    utils::write_value(out, scheduled_pairs_);
+    utils::write_value(out, schedule_round_);
+    std::ostringstream vocabulary;
+    dict_->save_vocabulary(vocabulary);
+    const std::string& bytes = vocabulary.str();
+    utils::write_value(out, int64_t(bytes.size()));
+    out.write(bytes.data(), bytes.size());
+    utils::write_value(out, int32_t(replicas_.size()));
+    for (auto& replica : replicas_) {
+        utils::write_value(out, int64_t(replica.vectors->size()));
+        for (auto& row : *replica.vectors) {
+            out.write(reinterpret_cast<const char*>(row.data_), args_->dimension * sizeof(real));
+        }
+        utils::write_value(out, int64_t(replica.touched.size()));
+        out.write(reinterpret_cast<const char*>(replica.touched.data()), replica.touched.size());
+    }
+    utils::write_value(out, int32_t(mid_epoch ? thread_states_.size() : 0));
+    for (size_t i = 0; mid_epoch && i < thread_states_.size(); i++) {
+        const ThreadState& state = thread_states_[i];
+        utils::write_value(out, state.offset);
+        utils::write_value(out, state.position);
+        utils::write_value(out, int64_t(state.line.size()));
+        out.write(reinterpret_cast<const char*>(state.line.data()), state.line.size() * sizeof(int32_t));
+        utils::write_value(out, state.token_count);
+        utils::write_value(out, state.iter_count);
+        utils::write_value(out, state.syncs_done);
+        utils::write_value(out, state.states_done);
+        utils::write_value(out, state.round);
+        utils::write_value(out, state.rng);
+        utils::write_value(out, state.performance);
+        utils::write_value(out, state.nexamples);
+        utils::write_value(out, state.stats);
+    }
+    out.close();
+    // so that a crash while saving leaves the previous state
+    if (!out || std::rename((path + ".tmp").c_str(), path.c_str()) != 0) {
+        std::cerr << "The training state could not be saved to " << path << "!" << std::endl;
+    }
+}
+
+void Minkowski::read_state() {
+    const std::string& path = args_->resume;
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        throw std::invalid_argument(path + " cannot be opened for resuming!");
+    }
+    const int64_t file_size = utils::size(in);
+    utils::seek(in, 0);
+    // a length read from the file, of items of the given size, that fits in it
+    auto read_length = [&](int64_t item_size) {
+        int64_t length = -1;
+        utils::read_value(in, length);
+        if (!in || length < 0 || length > (file_size - int64_t(in.tellg())) / item_size) {
+            throw std::invalid_argument(path + " is truncated.");
+        }
+        return length;
+    };
+    int32_t magic = 0, version = 0;
+    utils::read_value(in, magic);
+    utils::read_value(in, version);
+    if (magic != STATE_MAGIC || version != STATE_VERSION) {
+        throw std::invalid_argument(path + " is not a training state (see -state-tokens).");
+    }
+    std::vector<double> options(read_length(sizeof(double)));
+    in.read(reinterpret_cast<char*>(options.data()), options.size() * sizeof(double));
+    if (options != state_options(*args_)) {
+        throw std::invalid_argument("-resume needs the options of the run that saved " + path +
+                                    " (e.g. -dimension, -threads, -epochs and the learning rates).");
+    }
+    std::unique_ptr<TrainingState> state(new TrainingState());
+    int32_t burnin = 0;
+    utils::read_value(in, burnin);
+    state->burnin = burnin;
+    utils::read_value(in, state->epoch);
+    utils::read_value(in, state->tokens_trained);
+    utils::read_value(in, state->train_tokens);
+    utils::read_value(in, state->scheduled_pairs);
+    utils::read_value(in, state->schedule_round);
+    state->vocabulary.resize(read_length(1));
+    in.read(&state->vocabulary[0], state->vocabulary.size());
+    int32_t num_replicas = 0;
+    utils::read_value(in, num_replicas);
+    for (int32_t r = 0; r < num_replicas && in; r++) {
+        int64_t rows = read_length(args_->dimension * sizeof(real));
+        state->replicas.push_back(std::vector<real>(rows * args_->dimension));
+        in.read(reinterpret_cast<char*>(state->replicas.back().data()), rows * args_->dimension * sizeof(real));
+        state->touched.push_back(std::vector<uint8_t>(read_length(1)));
+        in.read(reinterpret_cast<char*>(state->touched.back().data()), state->touched.back().size());
     }
+    int32_t num_threads = 0;
+    utils::read_value(in, num_threads);
+    state->threads.resize(std::max(std::min(num_threads, args_->threads), 0));
+    for (auto& thread : state->threads) {
+        utils::read_value(in, thread.offset);
+        utils::read_value(in, thread.position);
+        thread.line.resize(read_length(sizeof(int32_t)));
+        in.read(reinterpret_cast<char*>(thread.line.data()), thread.line.size() * sizeof(int32_t));
+        utils::read_value(in, thread.token_count);
+        utils::read_value(in, thread.iter_count);
+        utils::read_value(in, thread.syncs_done);
+        utils::read_value(in, thread.states_done);
+        utils::read_value(in, thread.round);
+        utils::read_value(in, thread.rng);
+        utils::read_value(in, thread.performance);
+        utils::read_value(in, thread.nexamples);
+        utils::read_value(in, thread.stats);
+    }
+    if (!in || num_replicas != args_->replicas || (num_threads != 0 && num_threads != args_->threads)) {
+        throw std::invalid_argument(path + " is truncated.");
+    }
+    resume_state_ = std::move(state);
 }
 
-void Minkowski::train_epochs(int32_t num_epochs, int32_t seed, real start_lr, real end_lr, bool checkpoint) {
+void Minkowski::restore_state() {
+    const TrainingState& state = *resume_state_;
+    for (size_t r = 0; r < replicas_.size(); r++) {
+        std::vector<Vector>& vectors = *replicas_[r].vectors;
+        if (state.replicas[r].size() != vectors.size() * args_->dimension) {
+            throw std::invalid_argument("The vectors of " + args_->resume + " do not match its vocabulary.");
+        }
+        for (size_t i = 0; i < vectors.size(); i++) {
+            std::copy(&state.replicas[r][i * args_->dimension], &state.replicas[r][(i + 1) * args_->dimension],
+                      vectors[i].data_);
+        }
+        if (!state.touched[r].empty()) {
+            replicas_[r].touched = state.touched[r];
+        }
+    }
+    tokens_trained_ = state.tokens_trained;
+    last_checkpoint_tokens_ = tokens_trained_;
+    scheduled_pairs_ = state.scheduled_pairs;
+    schedule_round_ = state.schedule_round;
+    if (!state.threads.empty()) {
+        thread_states_ = state.threads;
+        resuming_epoch_ = true;
+    }
+    std::cerr << "Resuming " << (state.burnin ? "burn-in epoch " : "epoch ") << state.epoch + 1
+              << (resuming_epoch_ ? " in progress" : "") << ", after " << tokens_trained_ << " tokens" << std::endl;
+}
+
+void Minkowski::train_epochs(int32_t num_epochs, int32_t seed, real start_lr, real end_lr, bool checkpoint,
+                             int32_t first_epoch) {
     real lr_delta_per_epoch = (start_lr - end_lr) / num_epochs;
-    for (int32_t epoch = 0; epoch < num_epochs; epoch++) {
-        if (checkpoint) {
+    for (int32_t epoch = first_epoch; epoch < num_epochs; epoch++) {
+        current_epoch_ = epoch;
+        if (checkpoint && !resuming_epoch_) {
             save_checkpoint(epoch);
         }
         std::cerr << "\rEpoch: " << (epoch + 1) << " / " << num_epochs << "\n";
         std::cerr << std::flush;
         real epoch_start_lr = start_lr - real(epoch) * lr_delta_per_epoch;
         real epoch_end_lr = start_lr - real(epoch + 1) * lr_delta_per_epoch;
+        lock_stats_ = LockStats();
         std::vector<std::thread> threads;
         for (int32_t thread_id = 0; thread_id < args_->threads; thread_id++) {
-            int32_t thread_seed = seed + epoch * args_->threads + thread_id;
             threads.push_back(std::thread([=]() {
-                epoch_thread(thread_id, thread_seed, epoch_start_lr, epoch_end_lr);
+                epoch_thread(thread_id, seed, epoch, epoch_start_lr, epoch_end_lr);
             }));
         }
         for (auto it = threads.begin(); it != threads.end(); ++it) {
             it->join();
         }
+        resuming_epoch_ = false;
+        if (args_->replicas > 1) {
+            // so that the epoch ends (and any checkpoint is taken) in consensus
+            merge_replicas(0, vectors_->size());
+        }
+        print_lock_stats();
+        tokens_trained_ += args_->input_format == input_format_name::pairs ? pair_file_->num_pairs : train_tokens_;
+        if (args_->state_tokens > 0) {
+            save_state(false);
+        }
     }
     if (checkpoint) {
         save_checkpoint(num_epochs);
@@ -206,16 +1596,36 @@ void Minkowski::train_epochs(int32_t num_epochs, int32_t seed, real start_lr, re
 }
 
 void Minkowski::generate_negative_samples(const std::vector<int64_t>& counts) {
+    std::vector<real> weights(counts.size());
     real z = 0.0;
+    negatives_log_counts_.resize(counts.size());
+    expected_negatives_log_count_ = 0.0;
     for (size_t i = 0; i < counts.size(); i++) {
-        z += pow(counts[i], args_->distribution_power);
+        weights[i] = pow(counts[i], args_->distribution_power);
+        negatives_log_counts_[i] = log(counts[i]);
+        z += weights[i];
+        expected_negatives_log_count_ += weights[i] * negatives_log_counts_[i];
     }
-    for (size_t i = 0; i < counts.size(); i++) {
-        real c = pow(counts[i], args_->distribution_power);
-        for (size_t j = 0; j < c * NEGATIVE_TABLE_SIZE / z; j++) {
-            negatives_->push_back(i);
-        }
+    expected_negatives_log_count_ /= z;
+    negatives_ = std::make_shared<AliasTable>(weights);
+}
+
+void Minkowski::print_lock_stats() {
+    const LockStats& s = lock_stats_;
+    int64_t pairs = s.pairs_trained + s.pairs_skipped;
+    int64_t drawn = std::max(s.negatives_drawn, int64_t(1));
+    int64_t accepted = std::max(s.negatives_drawn - s.negatives_rejected, int64_t(1));
+    std::cerr << std::fixed << std::setprecision(2);
+    std::cerr << "Locking: " << 100. * s.pairs_trained / std::max(pairs, int64_t(1)) << "% of pairs trained, ";
+    std::cerr << s.pairs_skipped << " skipped, " << s.pairs_deferred << " deferred; ";
+    if (args_->loss == loss_name::hs) {
+        std::cerr << "nodes: " << s.nodes_contended << " contended, " << s.nodes_skipped << " skipped" << std::endl;
+        return;
     }
+    std::cerr << "negatives: " << 100. * s.negatives_rejected / drawn << "% of draws rejected, ";
+    std::cerr << s.negatives_dropped << " dropped, mean log-count ";
+    std::cerr << s.negatives_log_count / accepted << " (unbiased " << expected_negatives_log_count_ << ")";
+    std::cerr << std::endl;
 }
 
 }
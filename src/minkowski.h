@@ -2,22 +2,151 @@
 
 #include <time.h>
 
+#include <chrono>
+#include <istream>
 #include <memory>
 #include <set>
 #include <mutex>
-#include <random>
 #include <atomic>
+#include <condition_variable>
 
+#include "alias_table.h"
 #include "args.h"
+#include "checkpointer.h"
 #include "dictionary.h"
+#include "huffman_tree.h"
 #include "model.h"
+#include "pairs.h"
+#include "random.h"
 #include "real.h"
 #include "utils.h"
 #include "vector.h"
+#include "vector_delta.h"
+#include "vector_file.h"
 
 namespace minkowski {
 
-static const int32_t NEGATIVE_TABLE_SIZE = 100000000; // increased from the original
+/*
+ * Counts kept by each thread on how the locks of the vectors were acquired,
+ * used to report the effect of the lock policy.
+ */
+struct LockStats {
+    int64_t pairs_trained = 0;
+    int64_t pairs_skipped = 0;       // dropped because of contention
+    int64_t pairs_deferred = 0;      // retried at the end of the line
+    int64_t negatives_drawn = 0;
+    int64_t negatives_rejected = 0;  // draws that were locked or duplicates
+    int64_t negatives_dropped = 0;   // slots left empty: too few words, or out of retries
+    real negatives_log_count = 0;    // sum of log counts of used negatives
+    int64_t nodes_contended = 0;     // with -loss hs, path nodes that were locked
+    int64_t nodes_skipped = 0;       // of these, those left out of their pair
+
+    void add(const LockStats& other) {
+        pairs_trained += other.pairs_trained;
+        pairs_skipped += other.pairs_skipped;
+        pairs_deferred += other.pairs_deferred;
+        negatives_drawn += other.negatives_drawn;
+        negatives_rejected += other.negatives_rejected;
+        negatives_dropped += other.negatives_dropped;
+        negatives_log_count += other.negatives_log_count;
+        nodes_contended += other.nodes_contended;
+        nodes_skipped += other.nodes_skipped;
+    }
+};
+
+/*
+ * Scratch space for training pairs one at a time, and the pairs deferred
+ * (with -lock-policy deferred) until the end of the line or block.
+ */
+struct PairScratch {
+    std::vector<int32_t> samples;
+    std::vector<int32_t> lock_order;
+    std::vector<bool> codes;         // with -loss hs
+    std::vector<int32_t> contended;  // with -loss hs
+    std::vector<std::pair<int32_t, int32_t>> deferred;
+};
+
+/*
+ * A copy of the embedding matrix together with the locks of its rows.  With
+ * -replicas N, each of N groups of threads trains a replica of its own on its
+ * share of the corpus, and the replicas are merged periodically.
+ */
+struct Replica {
+    std::shared_ptr<std::vector<Vector>> vectors;
+    std::shared_ptr<std::vector<std::mutex>> flags;
+    std::vector<uint8_t> touched; // rows updated since the last merge
+};
+
+/*
+ * The pairs drawn by a thread in a round of -lock-policy scheduled, each with
+ * its samples (the target and the negatives), and for each row of each pair
+ * (its source, then its samples) the pair of the round that must be applied
+ * before it, if any.
+ */
+struct ScheduledPairs {
+    std::vector<int32_t> sources;
+    std::vector<int32_t> targets;
+    std::vector<real> lrs;
+    std::vector<int32_t> samples;
+    std::vector<int64_t> sample_begin; // into samples, one more than pairs
+    std::vector<int64_t> positions;    // in the order of the round
+    // the position of the preceding pair on the nth row of pair k (or -1) is
+    // at k + sample_begin[k] + n; it is found by the thread owning the row
+    std::vector<int64_t> dependencies;
+    // for each thread, the rows of these pairs that it owns, as (k, n)
+    std::vector<std::vector<std::pair<int64_t, int32_t>>> owned;
+    // the sum of the updates of this thread to each shared row as a negative
+    std::vector<Vector> shared_tangents;
+
+    void clear() {
+        sources.clear();
+        targets.clear();
+        lrs.clear();
+        samples.clear();
+        sample_begin.assign(1, 0);
+        positions.clear();
+        dependencies.clear();
+        for (auto& rows : owned) {
+            rows.clear();
+        }
+    }
+    size_t size() const { return sources.size(); }
+};
+
+/*
+ * Where a thread is within its share of an epoch, saved with the training
+ * state (see Minkowski::save_state), so that it can resume from there.
+ */
+struct ThreadState {
+    int64_t offset = 0;         // of the input stream, or -1 at its end
+    LinePosition position;
+    std::vector<int32_t> line;  // as carried by get_chunk
+    int64_t token_count = 0;
+    int64_t iter_count = 0;
+    int64_t syncs_done = 0;
+    int64_t states_done = 0;
+    int64_t round = 0;          // with -lock-policy scheduled
+    Rng rng = Rng(0);
+    real performance = 0.;      // the sums of the objective of the thread
+    int64_t nexamples = 1;
+    LockStats stats;
+};
+
+/*
+ * A training state read for -resume.
+ */
+struct TrainingState {
+    bool burnin = false;
+    int32_t epoch = 0;         // in progress, if there are thread states, or else the next
+    int64_t tokens_trained = 0;
+    int64_t train_tokens = 0;
+    int64_t scheduled_pairs = 0;
+    int64_t schedule_round = 0;
+    std::string vocabulary;    // as written by Dictionary::save_vocabulary
+    std::vector<std::vector<real>> replicas; // the rows of each, one after the other
+    std::vector<std::vector<uint8_t>> touched;
+    std::vector<ThreadState> threads;
+};
 
 class Minkowski {
 protected:
@@ -27,17 +156,177 @@ protected:
     std::shared_ptr<std::vector<Vector>> vectors_;
     std::shared_ptr<std::vector<std::mutex>> vector_flags_;
 
-    std::shared_ptr<std::vector<int32_t>> negatives_;
+    // the file trained on in each epoch, and its number of tokens (-input,
+    // unless lines of -replay are mixed in)
+    std::string train_input_;
+    int64_t train_tokens_;
+    // train_input_ mapped into memory, when it is read by several models
+    std::shared_ptr<utils::MappedFile> corpus_;
+
+    // replicas_[0] consists of vectors_ and vector_flags_
+    std::vector<Replica> replicas_;
+    std::shared_ptr<utils::Barrier> merge_barrier_;
+
+    std::shared_ptr<AliasTable> negatives_;
+    // log of the count of each word, and its expectation under the
+    // negative sampling distribution: a measure of sampling bias
+    std::vector<real> negatives_log_counts_;
+    real expected_negatives_log_count_;
+    // with -input-format pairs
+    std::shared_ptr<PairFile> pair_file_;
+    // with -loss hs; its internal nodes follow the words in vectors_
+    std::shared_ptr<HuffmanTree> tree_;
     std::shared_ptr<Model> model_;
     std::atomic<bool> burnin_;
 
-    void train_epochs(int32_t num_epochs, int32_t seed, real start_lr, real end_lr, bool checkpoint);
+    // with -lock-policy scheduled: the pairs of each thread in this round,
+    // the number of pairs of all previous rounds, the last pair (counted over
+    // all rounds) to update each row, and the round each pair of this round
+    // was last applied in (by position); the number of shared rows, and
+    // their values at the start of the round
+    std::vector<ScheduledPairs> schedule_;
+    int64_t scheduled_pairs_;
+    int64_t schedule_round_;
+    std::vector<int64_t> last_update_;
+    std::vector<std::atomic<int64_t>> pair_done_;
+    int32_t shared_rows_;
+    std::vector<Vector> shared_snapshot_;
+    // threads waiting for a pair past SCHEDULE_SPINS, woken when pairs are
+    // applied (with more threads than cores, spinning would starve them)
+    std::atomic<int32_t> schedule_waiters_;
+    std::mutex schedule_mutex_;
+    std::condition_variable schedule_applied_;
+
+    LockStats lock_stats_; // for the current epoch
+    std::mutex lock_stats_mutex_;
+
+    // with any of the -checkpoint-* options
+    std::unique_ptr<Checkpointer> checkpointer_;
+    // tokens (or pairs) trained in the previous epochs, and when the last
+    // checkpoint by -checkpoint-tokens or -checkpoint-seconds was requested
+    int64_t tokens_trained_;
+    int64_t last_checkpoint_tokens_;
+    std::chrono::steady_clock::time_point last_checkpoint_time_;
+    // the rows of vectors_ updated since they were last copied for a
+    // checkpoint; the delta checkpoints requested since the last full one
+    // (-1 before the first); and the file of the last checkpoint written
+    // (by the background thread)
+    std::shared_ptr<std::vector<uint8_t>> dirty_rows_;
+    int32_t deltas_since_full_;
+    std::string last_checkpoint_file_;
+
+    // the epoch being trained (of the burn-in epochs, if burnin_)
+    int32_t current_epoch_;
+    // with -state-tokens, the state of each thread at the last pause; with
+    // -resume, that of the epoch resumed, if resuming_epoch_
+    std::vector<ThreadState> thread_states_;
+    bool resuming_epoch_;
+    std::unique_ptr<TrainingState> resume_state_;
+
+    /*
+     * Determine the vocabulary from the input and build the distribution of
+     * the negative samples.
+     */
+    void build_vocabulary();
+
+    /*
+     * Open train_input_ for reading, from memory if it is mapped.
+     */
+    std::unique_ptr<std::istream> open_input() const;
+
+    /*
+     * Initialise the vectors and train them on the vocabulary built already.
+     */
+    void train_vectors();
+
+    /*
+     * Write the lines of -input, together with a random sample of
+     * -replay-fraction of the lines of -replay, in random order, to `path`.
+     * Only the offsets of the lines are held in memory.
+     */
+    void mix_replay(const std::string& path);
+
+    /*
+     * Replace the vectors of the words that have one in -init-vectors by
+     * it.  Each of the other words is placed near the Lorentzian centroid of
+     * the loaded vectors of the words it co-occurs with in the corpus (within
+     * the window), displaced in a random direction by a distance of the order
+     * of -init-std-dev, or is left at its random initial point if there are
+     * none.
+     */
+    void load_init_vectors(Rng& rng);
+
+    /*
+     * Train the epochs from `first_epoch` (when resuming) to `num_epochs`.
+     */
+    void train_epochs(int32_t num_epochs, int32_t seed, real start_lr, real end_lr, bool checkpoint,
+                      int32_t first_epoch = 0);
+
+    /*
+     * Save the training state to <output>.state (replacing the previous
+     * one): the options it depends on, the vocabulary, the vectors of all
+     * replicas, where training is (burn-in or not, the epoch and the tokens
+     * trained), and, if `mid_epoch`, the state of each thread in
+     * thread_states_, which must all be paused.  Otherwise the state is that
+     * of the start of the next epoch.
+     */
+    virtual void save_state(bool mid_epoch);
+
+    /*
+     * Read the training state of -resume into resume_state_.  Throws
+     * invalid_argument if it is not a state file, or was saved with options
+     * that training depends on that differ from those of this run.
+     */
+    void read_state();
+
+    /*
+     * Restore the vectors, and where training is, from resume_state_.
+     */
+    void restore_state();
 
     void save_checkpoint(int32_t epochs_trained);
 
     /*
-     * Given a vector of the word counts, generate a vector of negative samples
-     * to be used.
+     * Request a checkpoint if one is due by -checkpoint-tokens or
+     * -checkpoint-seconds, given the tokens (or pairs) trained by thread 0 in
+     * this epoch; called by thread 0 only.  With -lock-policy scheduled, it
+     * is called while the other threads wait, and the snapshot is copied
+     * before returning.
+     */
+    void maybe_checkpoint(int64_t thread_tokens);
+
+    /*
+     * Save the first dict_->nwords_ of the given vectors, as per
+     * -output-format, formatting the text on `threads` threads.
+     */
+    void write_vectors(const std::string& fn, const std::vector<Vector>& vectors, int32_t threads) const;
+
+    /*
+     * Write a checkpoint from the snapshot of the Checkpointer: in full, or
+     * as a delta of the rows `changed` since the previous checkpoint, to
+     * <fn>.delta.
+     */
+    void write_checkpoint(const std::string& fn, const std::vector<Vector>& vectors,
+                          const std::vector<uint8_t>* changed);
+
+    void print_lock_stats();
+
+    /*
+     * Create the replicas of the embedding matrix, as copies of vectors_.
+     */
+    void create_replicas();
+
+    /*
+     * Replace the rows in the given range that have been touched in any
+     * replica since the last merge by the Lorentzian centroid of their
+     * copies, in all replicas.
+     */
+    void merge_replicas(int64_t begin, int64_t end);
+
+    /*
+     * Given a vector of the word counts, build the alias table from which
+     * negative samples are drawn (the unigram distribution raised to
+     * -distribution-power).
      */
     void generate_negative_samples(const std::vector<int64_t>&);
 
@@ -46,31 +335,200 @@ protected:
      * succeeds, then proceed to lock the specified number of negative samples,
      * which are guaranteed to be distinct, and return true, in which case the
      * vector `samples` is populated with target, and then the negative samples.
+     * Negatives that are already locked are redrawn, as are repeated ones
+     * (see draw_distinct_negatives); if -negative-retries is non-negative,
+     * then after that many redraws the remaining slots are left empty.
      * If false is returned, then `samples` is unchanged.
      */
-    bool obtain_vectors(int32_t source, int32_t target, std::vector<int32_t>& samples, int32_t num_negatives, std::minstd_rand& rng);
+    bool obtain_vectors(Replica& replica, int32_t source, int32_t target, std::vector<int32_t>& samples, int32_t num_negatives, Rng& rng, LockStats& stats);
 
     /*
-     * Release the locks of source and all the samples provided.
+     * As for obtain_vectors, for a source that this thread has locked
+     * already: only the target and the negatives are locked.
      */
-    void release_vectors(int32_t source, std::vector<int32_t>& samples);
+    bool obtain_samples(Replica& replica, int32_t source, int32_t target, std::vector<int32_t>& samples, int32_t num_negatives, Rng& rng, LockStats& stats);
 
     /*
-     * Return the word id of a negative sample, sampled uniformly at random
-     * from the pregenerated list of negative samples using this->rng.
+     * Populate `samples` with the target and the specified number of distinct
+     * negative samples (distinct also from the source), then lock all of
+     * these and the source, waiting as necessary.  Locks are acquired in
+     * ascending order of word id (using `lock_order` as scratch space), so
+     * that no deadlock is possible.  Never fails.
+     */
+    void obtain_vectors_sorted(Replica& replica, int32_t source, int32_t target, std::vector<int32_t>& samples, std::vector<int32_t>& lock_order, int32_t num_negatives, Rng& rng, LockStats& stats);
+
+    /*
+     * Lock the source, waiting as necessary, then try to lock each internal
+     * node on the path of the target in the Huffman tree, without waiting:
+     * the nodes near the root are on most paths, so waiting for them would
+     * serialize the threads.  Populate `samples` and `codes` with the nodes
+     * locked and their branches, and `contended` with the indices into the
+     * path of the others.
+     */
+    void obtain_path(Replica& replica, int32_t source, int32_t target, std::vector<int32_t>& samples, std::vector<bool>& codes, std::vector<int32_t>& contended, LockStats& stats);
+
+    /*
+     * Release the locks of source and all the samples provided, marking them
+     * as touched.
+     */
+    void release_vectors(Replica& replica, int32_t source, std::vector<int32_t>& samples);
+
+    /*
+     * Release the locks of the samples provided (but not of the source),
+     * marking them as touched.
+     */
+    void release_samples(Replica& replica, std::vector<int32_t>& samples);
+
+    /*
+     * Return the word id of a negative sample, sampled from the alias table
+     * of negative samples using `rng`.
      * Guaranteed to not coincide with the provided index `target`.
      */
-    int32_t get_negative_sample(int32_t target, std::minstd_rand& rng);
+    int32_t get_negative_sample(int32_t target, Rng& rng);
+
+    /*
+     * Append negatives for the target `samples[first]` to `samples`, until
+     * there are `num_negatives` after it, none of them repeated or among the
+     * `num_excluded` words at `excluded`.  No more are drawn than there are
+     * such words in the vocabulary, and if -negative-retries is non-negative,
+     * then after that many redraws the remaining slots are left empty.  With
+     * `locking`, each negative is also locked in that replica without
+     * waiting, once it is known to be new, and is redrawn if it can't be.
+     */
+    void draw_distinct_negatives(const int32_t* excluded, size_t num_excluded, std::vector<int32_t>& samples, size_t first, int32_t num_negatives, Rng& rng, LockStats& stats, Replica* locking = nullptr);
 
 public:
     Minkowski(std::shared_ptr<Args> args);
+    virtual ~Minkowski() {}
 
     void save_vectors(std::string);
     void print_info(clock_t, real, int64_t, real, real);
 
-    void skipgram(Model&, real, const std::vector<int32_t>&, std::minstd_rand& rng);
-    void epoch_thread(int32_t thread_id, int32_t seed, real start_lr, real end_lr);
+    /*
+     * Train the skip-gram pairs of the centers [begin, end) of the line (a
+     * chunk, as read by Dictionary::get_chunk), with their contexts in it.
+     */
+    void skipgram(Model&, Replica&, real, const std::vector<int32_t>& line, int32_t begin, int32_t end, Rng& rng, LockStats& stats);
+
+    /*
+     * Train the given (source, target) pairs, a pair at a time, acquiring
+     * the locks as per -lock-policy; pairs of a word with itself are skipped.
+     */
+    void train_pairs(Model&, Replica&, real, const std::vector<std::pair<int32_t, int32_t>>& pairs, Rng& rng, LockStats& stats);
+
+    /*
+     * Train the pair (source, target), acquiring the locks as per
+     * -lock-policy, unless the source is the target.  With -lock-policy
+     * deferred, a contended pair is added to scratch.deferred instead.
+     */
+    void train_pair(Model&, Replica&, real, int32_t source, int32_t target, int32_t num_negatives, PairScratch& scratch, Rng& rng, LockStats& stats);
+
+    /*
+     * Train the pairs in scratch.deferred, waiting for their locks, and clear it.
+     */
+    void train_deferred(Model&, Replica&, real, int32_t num_negatives, PairScratch& scratch, Rng& rng, LockStats& stats);
+
+    /*
+     * As for skipgram, but collecting the pairs of -pair-buffer center words
+     * at a time, and training them grouped by source word, in ascending
+     * order of word id, so that the source row is locked (unless the lock
+     * policy is `sorted`) and loaded once per group.  The negatives of each
+     * pair are visited in ascending order of word id.
+     */
+    void skipgram_buffered(Model&, Replica&, real, const std::vector<int32_t>& line, int32_t begin, int32_t end, Rng& rng, LockStats& stats);
+
+    /*
+     * Train the Lorentzian centroid of the context of each center of the line
+     * to predict that word, against negative samples drawn for it (see
+     * Model::cbow_negative_sampling).  The locks are always acquired in
+     * sorted order.  Each center word counts as one trained pair.
+     */
+    void cbow(Model&, Replica&, real, const std::vector<int32_t>& line, int32_t begin, int32_t end, Rng& rng, LockStats& stats);
+
+    /*
+     * As for skipgram, but training all the context words of each center
+     * word at once (see Model::minibatch_negative_sampling), with one set of
+     * negative samples shared by the window.  The locks of the window are
+     * always acquired in sorted order.
+     */
+    void skipgram_minibatch(Model&, Replica&, real, const std::vector<int32_t>& line, int32_t begin, int32_t end, Rng& rng, LockStats& stats);
+    /*
+     * Train on this thread's share of the corpus for one epoch.  The
+     * subsampling randomness depends only on `seed` and `epoch` (and the
+     * corpus), the negative samples additionally on the thread.
+     */
+    virtual void epoch_thread(int32_t thread_id, int32_t seed, int32_t epoch, real start_lr, real end_lr);
+
+    /*
+     * The epoch_thread of -input-format pairs: train on this thread's share
+     * of the pair file, a block at a time, each pair repeated in proportion
+     * to its weight (by stochastic rounding) and each block shuffled.
+     */
+    void pairs_epoch_thread(int32_t thread_id, int32_t seed, int32_t epoch, real start_lr, real end_lr);
+
+    /*
+     * The epoch_thread of -lock-policy scheduled.  The epoch proceeds in
+     * rounds of SCHEDULE_ROUND_TOKENS tokens per thread: each thread draws
+     * the pairs of its share of the round and their negatives (these depend
+     * only on the seed, the epoch and the position of the line in the
+     * corpus); the pairs of all threads are put in order, taking one of each
+     * thread in turn, and each thread then applies its own pairs, waiting as
+     * necessary for those that precede them on one of their rows.  No row is
+     * updated by two threads at once, and each row sees its updates in the
+     * same order in every run.
+     *
+     * The most frequent words are drawn as negatives by most pairs, and
+     * would make each pair wait for the last; so the first shared_rows_
+     * rows, as negatives, are read from a snapshot taken at the start of the
+     * round, and their updates are summed and applied at its end (in the
+     * order of the threads, see flush_shared_rows).  As sources and targets,
+     * they are updated in order, as the other rows are.
+     */
+    void scheduled_epoch_thread(int32_t thread_id, int32_t seed, int32_t epoch, real start_lr, real end_lr);
+
+    /*
+     * Add the skip-gram pairs of the centers [begin, end) of the line, with
+     * their samples, to `pairs`.
+     */
+    void schedule_line(const std::vector<int32_t>& line, int32_t begin, int32_t end, real lr, int32_t num_negatives, Rng& rng, ScheduledPairs& pairs, LockStats& stats);
+
+    /*
+     * Find the position of each pair of this thread in the order of the
+     * round, and which thread owns each of their rows (row i is owned by
+     * thread i mod -threads); copy the shared rows this thread owns into
+     * the snapshot.  Called by all threads, once all have drawn their pairs.
+     */
+    void position_schedule(int32_t thread_id);
+
+    /*
+     * For each pair of the round with one of the rows this thread owns,
+     * record the last pair before it in the order of the round to update
+     * that row.  Called by all threads, once all have positioned their pairs.
+     */
+    void order_schedule(int32_t thread_id);
+
+    /*
+     * Apply the pairs of this thread in the current round.
+     */
+    void apply_schedule(Model&, ScheduledPairs& pairs, LockStats& stats);
+
+    /*
+     * Update each shared row that this thread owns with the sum of the
+     * updates of all threads to it as a negative in this round.  Called by
+     * all threads, once all have applied their pairs.
+     */
+    void flush_shared_rows(int32_t thread_id, Model& model);
+
     void train();
 
+    /*
+     * Train a model for each combination of the start learning rates of
+     * -sweep-lr and the dimensions of -sweep-dimension, one after the other,
+     * all sharing the vocabulary, the negative sampling distribution and the
+     * corpus (mapped into memory once), and save the vectors of each to
+     * <output>-dim-<dimension>-lr-<lr>.  The end learning rate of each is
+     * scaled with its start learning rate.
+     */
+    void sweep();
 };
 }
@@ -16,7 +16,8 @@ constexpr real MAX_MINKOWSKI_DOT = -1 - 1e-10;
 Model::Model(std::shared_ptr<std::vector<Vector>> vectors,
              std::shared_ptr<Args> args)
     : acc_grad_source_(args->dimension),
-      grad_output_(args->dimension) {
+      grad_output_(args->dimension),
+      centroid_(args->dimension) {
     vectors_ = vectors;
     args_ = args;
     performance_ = 0.0;
@@ -39,7 +40,7 @@ real Model::binary_logistic(Vector& input, int32_t target, bool label, real lr)
     grad_output_ = input;
     grad_output_.multiply(lr * delta);
     grad_output_.project_onto_tangent_space(vectors_->at(target));
-    update(vectors_->at(target), grad_output_);
+    update(target, grad_output_);
 
     if (label) {
         return -std::log(score + 1e-8);
@@ -48,7 +49,8 @@ real Model::binary_logistic(Vector& input, int32_t target, bool label, real lr)
     }
 }
 
-void Model::update(Vector& point, Vector& tangent) {
+void Model::update(int32_t id, Vector& tangent) {
+    Vector& point = vectors_->at(id);
     real step_size = std::sqrt(minkowski_dot(tangent, tangent));
     // normalize the tangent vector
     tangent.multiply(1.0 / step_size);
@@ -61,6 +63,13 @@ void Model::update(Vector& point, Vector& tangent) {
     }
     // geodesic update
     point.geodesic_update(tangent, step_size);
+    if (dirty_) {
+        (*dirty_)[id] = 1;
+    }
+}
+
+void Model::track_dirty(std::shared_ptr<std::vector<uint8_t>> dirty) {
+    dirty_ = dirty;
 }
 
 void Model::log_bilinear_negative_sampling(int32_t source, std::vector<int32_t>& samples, real lr) {
@@ -72,7 +81,133 @@ void Model::log_bilinear_negative_sampling(int32_t source, std::vector<int32_t>&
 
     acc_grad_source_.multiply(lr);
     acc_grad_source_.project_onto_tangent_space(vectors_->at(source));
-    update(vectors_->at(source), acc_grad_source_);
+    update(source, acc_grad_source_);
+}
+
+void Model::log_bilinear_shared_negatives(int32_t source, std::vector<int32_t>& samples, int32_t shared,
+                                          const std::vector<Vector>& snapshot, std::vector<Vector>& tangents, real lr) {
+    Vector& input = vectors_->at(source);
+    acc_grad_source_.zero();
+    for (int32_t n = 0; n < samples.size(); n++) {
+        if (n == 0 || samples[n] >= shared) {
+            performance_ += binary_logistic(input, samples[n], n == 0, lr);
+            continue;
+        }
+        // as binary_logistic, for a negative
+        const Vector& output = snapshot[samples[n]];
+        real score = sigmoid(minkowski_dot(input, output) + SHIFT);
+        acc_grad_source_.add(output, -score);
+        grad_output_ = input;
+        grad_output_.multiply(-lr * score);
+        grad_output_.project_onto_tangent_space(output);
+        tangents[samples[n]].add(grad_output_);
+        performance_ += -std::log(1.0 - score + 1e-8);
+    }
+    nexamples_ += 1;
+
+    acc_grad_source_.multiply(lr);
+    acc_grad_source_.project_onto_tangent_space(input);
+    update(source, acc_grad_source_);
+}
+
+void Model::hierarchical_softmax(int32_t source, const std::vector<int32_t>& path,
+                                 const std::vector<bool>& code, real lr) {
+    acc_grad_source_.zero();
+    for (int32_t n = 0; n < path.size(); n++) {
+        performance_ += binary_logistic(vectors_->at(source), path[n], code[n], lr);
+    }
+    nexamples_ += 1;
+
+    acc_grad_source_.multiply(lr);
+    acc_grad_source_.project_onto_tangent_space(vectors_->at(source));
+    update(source, acc_grad_source_);
+}
+
+void Model::cbow_negative_sampling(const std::vector<int32_t>& context, std::vector<int32_t>& samples, real lr) {
+    centroid_.zero();
+    for (auto id : context) {
+        centroid_.add(vectors_->at(id));
+    }
+    real r = std::sqrt(-minkowski_dot(centroid_, centroid_));
+    centroid_.multiply(1.0 / r);
+
+    acc_grad_source_.zero();
+    for (int32_t n = 0; n < samples.size(); n++) {
+        performance_ += binary_logistic(centroid_, samples[n], n == 0, lr);
+    }
+    nexamples_ += 1;
+
+    // back through the centroid map, to the sum of the context rows
+    acc_grad_source_.project_onto_tangent_space(centroid_);
+    acc_grad_source_.multiply(lr / r);
+    int64_t n = args_->dimension;
+    for (auto id : context) {
+        std::copy(acc_grad_source_.data_, acc_grad_source_.data_ + n, grad_output_.data_);
+        grad_output_.project_onto_tangent_space(vectors_->at(id));
+        update(id, grad_output_);
+    }
+}
+
+void Model::minibatch_negative_sampling(const std::vector<int32_t>& inputs,
+                                        const std::vector<int32_t>& outputs, real lr) {
+    int64_t m = inputs.size();
+    int64_t k = outputs.size();
+    int64_t n = args_->dimension;
+    input_block_.resize(m * n);
+    output_block_.resize(k * n);
+    scores_.resize(m * k);
+    for (int64_t i = 0; i < m; i++) {
+        const Vector& row = vectors_->at(inputs[i]);
+        std::copy(row.data_, row.data_ + n, input_block_.begin() + i * n);
+    }
+    for (int64_t j = 0; j < k; j++) {
+        const Vector& row = vectors_->at(outputs[j]);
+        std::copy(row.data_, row.data_ + n, output_block_.begin() + j * n);
+    }
+    minkowski_gemm(input_block_.data(), output_block_.data(), scores_.data(), m, k, n);
+
+    // replace the scores by the (scaled) derivatives of the loss
+    for (int64_t i = 0; i < m; i++) {
+        for (int64_t j = 0; j < k; j++) {
+            real score = sigmoid(scores_[i * k + j] + SHIFT);
+            bool label = (j == 0);
+            if (label) {
+                performance_ += -std::log(score + 1e-8);
+            } else {
+                performance_ += -std::log(1.0 - score + 1e-8);
+            }
+            scores_[i * k + j] = lr * (real(label) - score);
+        }
+    }
+    nexamples_ += m;
+
+    // gradients of the inputs: scores x outputs; of the outputs: scores^T x inputs
+    input_grads_.assign(m * n, 0.);
+    output_grads_.assign(k * n, 0.);
+    for (int64_t i = 0; i < m; i++) {
+        real* input_grad = &input_grads_[i * n];
+        const real* input = &input_block_[i * n];
+        for (int64_t j = 0; j < k; j++) {
+            real delta = scores_[i * k + j];
+            const real* output = &output_block_[j * n];
+            real* output_grad = &output_grads_[j * n];
+            for (int64_t l = 0; l < n; l++) {
+                input_grad[l] += delta * output[l];
+                output_grad[l] += delta * input[l];
+            }
+        }
+    }
+
+    for (int64_t i = 0; i < m; i++) {
+        std::copy(input_grads_.begin() + i * n, input_grads_.begin() + (i + 1) * n, acc_grad_source_.data_);
+        acc_grad_source_.project_onto_tangent_space(vectors_->at(inputs[i]));
+        update(inputs[i], acc_grad_source_);
+    }
+    for (int64_t j = 0; j < k; j++) {
+        std::copy(output_grads_.begin() + j * n, output_grads_.begin() + (j + 1) * n, grad_output_.data_);
+        grad_output_.project_onto_tangent_space(vectors_->at(outputs[j]));
+        update(outputs[j], grad_output_);
+    }
 }
 
 real Model::get_performance() {
@@ -82,6 +217,16 @@ real Model::get_performance() {
     return avg;
 }
 
+void Model::get_performance_sums(real& performance, int64_t& nexamples) const {
+    performance = performance_;
+    nexamples = nexamples_;
+}
+
+void Model::set_performance_sums(real performance, int64_t nexamples) {
+    performance_ = performance;
+    nexamples_ = nexamples;
+}
+
 void Model::precompute_sigmoid() {
     t_sigmoid = new real[SIGMOID_TABLE_SIZE + 1];
     for (int i = 0; i < SIGMOID_TABLE_SIZE + 1; i++) {
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <vector>
+#include <cstdint>
 #include <utility>
 #include <memory>
 #include <mutex>
@@ -16,12 +17,22 @@ protected:
     std::shared_ptr<std::vector<Vector>> vectors_;
     std::shared_ptr<Args> args_;
     std::shared_ptr<std::vector<std::mutex>> vector_flags_;
+    std::shared_ptr<std::vector<uint8_t>> dirty_; // rows updated, if tracked
     Vector acc_grad_source_;
     Vector grad_output_;
+    Vector centroid_;
     real performance_;
     int64_t nexamples_;
     real* t_sigmoid;
 
+    // dense blocks of the minibatch: the rows of the inputs and outputs,
+    // their Minkowski inner products, and the gradients
+    std::vector<real> input_block_;
+    std::vector<real> output_block_;
+    std::vector<real> scores_;
+    std::vector<real> input_grads_;
+    std::vector<real> output_grads_;
+
     void precompute_sigmoid();
 
 public:
@@ -33,20 +44,71 @@ public:
 
     void log_bilinear_negative_sampling(int32_t source, std::vector<int32_t>& samples, real lr);
 
+    /*
+     * As log_bilinear_negative_sampling, except that the negatives among the
+     * first `shared` rows are not updated: they are read from `snapshot`
+     * (a copy of these rows), and the tangent vector of each of their updates
+     * (at the snapshot) is added to their entry of `tangents` instead.
+     */
+    void log_bilinear_shared_negatives(int32_t source, std::vector<int32_t>& samples, int32_t shared,
+                                       const std::vector<Vector>& snapshot, std::vector<Vector>& tangents, real lr);
+
+    /*
+     * Train the source against the internal nodes on the path of the target
+     * in the Huffman tree, making at each the binary decision `code`.
+     */
+    void hierarchical_softmax(int32_t source, const std::vector<int32_t>& path,
+                              const std::vector<bool>& code, real lr);
+
+    /*
+     * Train the Lorentzian centroid of the `context` rows against the
+     * `samples` (the first of which is the positive, the rest negatives).
+     * The gradient at the centroid m = s / r, where s is the sum of the
+     * context rows and r = sqrt(-<s, s>), is carried back to each of them
+     * as proj_m(g) / r, before the geodesic update of each.
+     * Pre: the samples are distinct, and distinct from the context.
+     */
+    void cbow_negative_sampling(const std::vector<int32_t>& context, std::vector<int32_t>& samples, real lr);
+
+    /*
+     * Train each of the `inputs` against all of the `outputs`, the first of
+     * which is the positive and the rest the (shared) negative samples.  The
+     * scores of all pairs are computed at once as a Minkowski matrix product,
+     * and then all gradients, from the values before the update, before all
+     * the rows are updated.
+     * Pre: the inputs and outputs are all distinct.
+     */
+    void minibatch_negative_sampling(const std::vector<int32_t>& inputs,
+                                     const std::vector<int32_t>& outputs, real lr);
+
     /*
      * Return a metric on the average performance of this model since the last
      * call to this function (so this function is not idempotent).
      */
     real get_performance();
 
+    /*
+     * Get or set the sums behind get_performance (to save and resume
+     * training).
+     */
+    void get_performance_sums(real& performance, int64_t& nexamples) const;
+    void set_performance_sums(real performance, int64_t nexamples);
+
     real sigmoid(real) const;
 
     /*
-     * Update (in place) the hyperboloid point in the direction of its
-     * (hyperboloid-)tangent vector `tangent`.  Uses the exponential map
-     * on the hyperboloid.
+     * Update (in place) the hyperboloid point of row `id` in the direction
+     * of its (hyperboloid-)tangent vector `tangent`.  Uses the exponential
+     * map on the hyperboloid.  Marks the row as dirty, if tracked.
+     */
+    void update(int32_t id, Vector& tangent);
+
+    /*
+     * Mark the rows this model updates in `dirty` (of a byte a row), e.g. for
+     * delta checkpoints.  As for the rows, concurrent models must not update
+     * the same row at once.
      */
-    void update(Vector& point, Vector& tangent);
+    void track_dirty(std::shared_ptr<std::vector<uint8_t>> dirty);
 };
 
 }
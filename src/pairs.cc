@@ -0,0 +1,221 @@
+#include "pairs.h"
+
+#include <math.h>
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include "random.h"
+#include "utils.h"
+
+namespace minkowski {
+
+using utils::read_value;
+using utils::write_value;
+
+constexpr int32_t PAIR_FILE_MAGIC = 0x4d4b5052; // "MKPR"
+constexpr int32_t PAIR_FILE_VERSION = 1;
+
+static_assert(sizeof(WeightedPair) == 12, "pairs are stored as 12-byte records");
+
+PairFile::PairFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        throw std::invalid_argument(path + " cannot be opened for training!");
+    }
+    int32_t magic = 0, version = 0, nwords = 0;
+    read_value(in, magic);
+    read_value(in, version);
+    if (magic != PAIR_FILE_MAGIC || version != PAIR_FILE_VERSION) {
+        throw std::invalid_argument(path + " is not a pair file (see the pairs command).");
+    }
+    read_value(in, nwords);
+    words.resize(nwords);
+    for (auto& word : words) {
+        int32_t length = 0;
+        read_value(in, word.count);
+        read_value(in, length);
+        word.word.resize(length);
+        in.read(&word.word[0], length);
+    }
+    read_value(in, num_pairs);
+    read_value(in, total_weight);
+    if (!in) {
+        throw std::invalid_argument(path + " is truncated.");
+    }
+    data_offset = in.tellg();
+}
+
+void PairFile::read(std::ifstream& in, int64_t first, int64_t count, std::vector<WeightedPair>& pairs) const {
+    pairs.resize(count);
+    in.clear();
+    in.seekg(std::streampos(data_offset + first * sizeof(WeightedPair)));
+    in.read(reinterpret_cast<char*>(pairs.data()), count * sizeof(WeightedPair));
+    if (!in) {
+        throw std::runtime_error("Failed to read the pairs from the pair file.");
+    }
+}
+
+PairAggregator::PairAggregator(std::shared_ptr<Args> args) : args_(args) {}
+
+void PairAggregator::add(int32_t source, int32_t target, double weight) {
+    weights_[(uint64_t(source) << 32) | uint32_t(target)] += weight;
+}
+
+void PairAggregator::count_cooccurrences() {
+    std::ifstream ifs(args_->input);
+    if (!ifs.is_open()) {
+        throw std::invalid_argument(args_->input + " cannot be opened for counting!");
+    }
+    Dictionary dict(args_);
+    {
+        utils::MappedFile corpus(args_->input);
+        dict.determine_vocabulary(corpus.data(), corpus.data() + corpus.size());
+    }
+    words_ = dict.words_;
+
+    Philox subsampling_rng(args_->seed, 0);
+    std::vector<int32_t> line;
+    LinePosition position;
+    int64_t tokens = 0;
+    int64_t reported = 0; // millions of tokens
+    while (ifs.peek() != EOF) {
+        tokens += dict.get_chunk(ifs, line, subsampling_rng, position);
+        for (int32_t w = position.begin; w < position.end; w++) {
+            for (int32_t c = -args_->window_size; c <= args_->window_size; c++) {
+                if (c != 0 && w + c >= 0 && w + c < line.size() && line[w] != line[w + c]) {
+                    add(line[w], line[w + c], 1.);
+                }
+            }
+        }
+        if (tokens / 1000000 > reported) {
+            reported = tokens / 1000000;
+            std::cerr << "\rCounted " << tokens / 1000000 << "M words, "
+                      << weights_.size() << " distinct pairs" << std::flush;
+        }
+    }
+    std::cerr << "\rCounted " << tokens / 1000000 << "M words, "
+              << weights_.size() << " distinct pairs" << std::endl;
+    if (args_->pair_weighting == pair_weighting_name::ppmi) {
+        apply_ppmi();
+    }
+}
+
+void PairAggregator::apply_ppmi() {
+    std::vector<double> source_totals(words_.size(), 0.), target_totals(words_.size(), 0.);
+    double total = 0.;
+    for (auto& pair : weights_) {
+        source_totals[pair.first >> 32] += pair.second;
+        target_totals[uint32_t(pair.first)] += pair.second;
+        total += pair.second;
+    }
+    for (auto it = weights_.begin(); it != weights_.end();) {
+        double pmi = log(it->second * total /
+                         (source_totals[it->first >> 32] * target_totals[uint32_t(it->first)]));
+        if (pmi > 0.) {
+            it->second = pmi;
+            ++it;
+        } else {
+            it = weights_.erase(it);
+        }
+    }
+}
+
+void PairAggregator::read_edges() {
+    std::ifstream ifs(args_->input);
+    if (!ifs.is_open()) {
+        throw std::invalid_argument(args_->input + " cannot be opened for reading edges!");
+    }
+    // number the nodes as they are encountered, then renumber them in
+    // decreasing order of degree, as the words of a dictionary
+    std::unordered_map<std::string, int32_t> ids;
+    std::vector<entry> nodes;
+    std::vector<std::pair<std::pair<int32_t, int32_t>, double>> edges;
+    std::string line;
+    while (std::getline(ifs, line)) {
+        std::istringstream fields(line);
+        std::string names[2];
+        double weight = 1.;
+        if (!(fields >> names[0] >> names[1])) {
+            continue; // blank line
+        }
+        fields >> weight;
+        int32_t endpoints[2];
+        for (int32_t i = 0; i < 2; i++) {
+            auto it = ids.find(names[i]);
+            if (it == ids.end()) {
+                it = ids.insert(std::make_pair(names[i], int32_t(nodes.size()))).first;
+                nodes.push_back(entry{names[i], 0});
+            }
+            endpoints[i] = it->second;
+            nodes[endpoints[i]].count++;
+        }
+        if (endpoints[0] != endpoints[1] && weight > 0.) {
+            edges.push_back(std::make_pair(std::make_pair(endpoints[0], endpoints[1]), weight));
+        }
+    }
+    std::vector<int32_t> order(nodes.size());
+    for (int32_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](int32_t a, int32_t b) {
+        return nodes[a].count > nodes[b].count;
+    });
+    std::vector<int32_t> new_ids(nodes.size());
+    words_.clear();
+    for (int32_t i = 0; i < order.size(); i++) {
+        new_ids[order[i]] = i;
+        words_.push_back(nodes[order[i]]);
+    }
+    for (auto& edge : edges) {
+        add(new_ids[edge.first.first], new_ids[edge.first.second], edge.second);
+    }
+    std::cerr << "Number of nodes:  " << words_.size() << std::endl;
+    std::cerr << "Number of edges:  " << weights_.size() << std::endl;
+}
+
+void PairAggregator::aggregate() {
+    if (args_->input_format == input_format_name::text) {
+        count_cooccurrences();
+    } else if (args_->input_format == input_format_name::edges) {
+        read_edges();
+    } else {
+        throw std::invalid_argument("The pairs command reads a corpus or an edge list.");
+    }
+    std::vector<WeightedPair> pairs;
+    pairs.reserve(weights_.size());
+    double total_weight = 0.;
+    for (auto& pair : weights_) {
+        pairs.push_back(WeightedPair{int32_t(pair.first >> 32), int32_t(uint32_t(pair.first)), float(pair.second)});
+        total_weight += pairs.back().weight;
+    }
+    weights_.clear();
+    if (pairs.empty()) {
+        throw std::invalid_argument("No pairs found in " + args_->input + ".");
+    }
+    Rng rng(args_->seed);
+    std::shuffle(pairs.begin(), pairs.end(), rng);
+
+    std::string path = args_->output + ".pairs";
+    std::ofstream ofs(path, std::ios::binary);
+    if (!ofs.is_open()) {
+        throw std::invalid_argument(path + " cannot be opened for saving pairs!");
+    }
+    write_value(ofs, PAIR_FILE_MAGIC);
+    write_value(ofs, PAIR_FILE_VERSION);
+    write_value(ofs, int32_t(words_.size()));
+    for (auto& word : words_) {
+        write_value(ofs, word.count);
+        write_value(ofs, int32_t(word.word.size()));
+        ofs.write(word.word.data(), word.word.size());
+    }
+    write_value(ofs, int64_t(pairs.size()));
+    write_value(ofs, total_weight);
+    ofs.write(reinterpret_cast<const char*>(pairs.data()), pairs.size() * sizeof(WeightedPair));
+    ofs.close();
+    std::cerr << "Wrote " << pairs.size() << " pairs to " << path << std::endl;
+}
+
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "args.h"
+#include "dictionary.h"
+
+namespace minkowski {
+
+/*
+ * A record of a pair file: a (source, target) pair of word ids and its
+ * weight.
+ */
+struct WeightedPair {
+    int32_t source;
+    int32_t target;
+    float weight;
+};
+
+/*
+ * A pair file consists of a header, holding the vocabulary (each word with
+ * its count, in decreasing order of count), the number of pairs and their
+ * total weight, followed by the pairs as WeightedPair records, in random
+ * order.  Numbers are stored in the byte order of the machine.
+ */
+class PairFile {
+public:
+    std::vector<entry> words;
+    int64_t num_pairs;
+    double total_weight;
+    int64_t data_offset; // of the first pair
+
+    /*
+     * Read the header of the pair file at `path`.  Throws invalid_argument
+     * if it can't be opened or is not a pair file.
+     */
+    explicit PairFile(const std::string& path);
+
+    /*
+     * Read `count` pairs, starting with the pair with index `first`, from the
+     * pair file open as `in`.
+     */
+    void read(std::ifstream& in, int64_t first, int64_t count, std::vector<WeightedPair>& pairs) const;
+};
+
+/*
+ * Builds a pair file from -input: from the co-occurrences of the words of a
+ * corpus (within -window-size of one another, after subsampling with -t),
+ * weighted as per -pair-weighting, or from the edges of an edge list.
+ */
+class PairAggregator {
+protected:
+    std::shared_ptr<Args> args_;
+    std::vector<entry> words_;
+    // weight of each pair, keyed by source << 32 | target
+    std::unordered_map<uint64_t, double> weights_;
+
+    void add(int32_t source, int32_t target, double weight);
+
+    void count_cooccurrences();
+    void read_edges();
+
+    /*
+     * Replace each co-occurrence count by its positive pointwise mutual
+     * information, dropping the pairs for which it is zero.
+     */
+    void apply_ppmi();
+
+public:
+    explicit PairAggregator(std::shared_ptr<Args> args);
+
+    /*
+     * Aggregate the pairs of -input, and write them, shuffled, to the pair
+     * file <output>.pairs.
+     */
+    void aggregate();
+};
+
+}
@@ -0,0 +1,257 @@
+#include "parameter_server.h"
+
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace minkowski {
+
+// how long workers wait for the servers to come up
+constexpr int32_t CONNECT_TIMEOUT_SECS = 60;
+
+std::vector<std::string> server_addresses(const Args& args) {
+    std::vector<std::string> addresses;
+    std::stringstream ss(args.servers);
+    std::string address;
+    while (std::getline(ss, address, ',')) {
+        if (!address.empty()) {
+            addresses.push_back(address);
+        }
+    }
+    if (addresses.empty()) {
+        throw std::invalid_argument("No parameter servers specified (-servers).");
+    }
+    return addresses;
+}
+
+ParameterServer::ParameterServer(std::shared_ptr<Args> args) : args_(args), num_rows_(-1) {
+    shutdown_ = false;
+    num_servers_ = server_addresses(*args_).size();
+    server_id_ = args_->server_id;
+    if (server_id_ < 0 || server_id_ >= num_servers_) {
+        throw std::invalid_argument("-server-id must index into -servers.");
+    }
+    barrier_ = std::make_shared<utils::Barrier>(args_->workers);
+}
+
+void ParameterServer::initialise(int64_t num_rows) {
+    std::lock_guard<std::mutex> lock(init_mutex_);
+    if (num_rows_ >= 0) {
+        if (num_rows != num_rows_) {
+            throw std::invalid_argument("Workers disagree on the size of the vocabulary.");
+        }
+        return;
+    }
+    num_rows_ = num_rows;
+    int64_t shard_size = (num_rows - server_id_ + num_servers_ - 1) / num_servers_;
+    Rng rng(args_->seed + server_id_);
+    Vector init_vector(args_->dimension);
+    vectors_ = std::make_shared<std::vector<Vector>>();
+    for (int64_t i = 0; i < shard_size; i++) {
+        random_hyperboloid_point(init_vector, rng, args_->init_std_dev);
+        vectors_->push_back(init_vector);
+    }
+    vector_flags_ = std::shared_ptr<std::vector<std::mutex>>(new std::vector<std::mutex>(shard_size));
+    std::cerr << "Server " << server_id_ << " holds " << shard_size << " of " << num_rows << " rows" << std::endl;
+}
+
+int64_t ParameterServer::position(int32_t id) const {
+    if (id < 0 || id >= num_rows_ || id % num_servers_ != server_id_) {
+        throw std::invalid_argument("Row " + std::to_string(id) + " is not held by this server.");
+    }
+    return id / num_servers_;
+}
+
+void ParameterServer::answer(const Message& request, Message& reply, std::unique_ptr<Model>& model) {
+    int64_t dim = args_->dimension;
+    reply.ids.clear();
+    reply.data.clear();
+    reply.type = uint32_t(message_type::ack);
+    if (!model && request.type != uint32_t(message_type::hello) && request.type != uint32_t(message_type::shutdown)) {
+        throw std::invalid_argument("Request of type " + std::to_string(request.type) + " before hello.");
+    }
+    switch (message_type(request.type)) {
+        case message_type::hello:
+            if (request.ids.size() != 2 || request.ids[0] <= 0) {
+                throw std::invalid_argument("Malformed hello.");
+            }
+            if (request.ids[1] != dim) {
+                throw std::invalid_argument("Worker has dimension " + std::to_string(request.ids[1]) +
+                                            ", not " + std::to_string(dim) + ".");
+            }
+            initialise(request.ids[0]);
+            model.reset(new Model(vectors_, args_));
+            break;
+        case message_type::pull:
+            reply.type = uint32_t(message_type::rows);
+            reply.data.resize(request.ids.size() * dim);
+            for (size_t n = 0; n < request.ids.size(); n++) {
+                int64_t i = position(request.ids[n]);
+                std::lock_guard<std::mutex> lock(vector_flags_->at(i));
+                const Vector& row = vectors_->at(i);
+                std::copy(row.data_, row.data_ + dim, reply.data.begin() + n * dim);
+            }
+            break;
+        case message_type::push: {
+            if (request.data.size() != request.ids.size() * dim) {
+                throw std::invalid_argument("Push of " + std::to_string(request.data.size()) + " coordinates for " +
+                                            std::to_string(request.ids.size()) + " rows.");
+            }
+            // all rows are checked before any is changed
+            for (auto id : request.ids) {
+                position(id);
+            }
+            Vector tangent(dim);
+            for (size_t n = 0; n < request.ids.size(); n++) {
+                int64_t i = position(request.ids[n]);
+                std::copy(request.data.begin() + n * dim, request.data.begin() + (n + 1) * dim, tangent.data_);
+                std::lock_guard<std::mutex> lock(vector_flags_->at(i));
+                // the row may have moved since it was pulled
+                tangent.project_onto_tangent_space(vectors_->at(i));
+                model->update(i, tangent);
+            }
+            break;
+        }
+        case message_type::barrier:
+            barrier_->wait();
+            break;
+        case message_type::shutdown:
+            shutdown_ = true;
+            listener_->close();
+            break;
+        default:
+            throw std::invalid_argument("Unexpected message type " + std::to_string(request.type) + ".");
+    }
+}
+
+void ParameterServer::handle(std::shared_ptr<Connection> connection) {
+    Message request, reply;
+    std::unique_ptr<Model> model; // created once the shard exists
+    try {
+        while (connection->receive(request)) {
+            try {
+                answer(request, reply, model);
+            } catch (const std::invalid_argument& e) {
+                std::cerr << "Server " << server_id_ << " refused a request: " << e.what() << std::endl;
+                reply.type = uint32_t(message_type::error);
+                reply.ids.clear();
+                reply.data.clear();
+            }
+            connection->send(reply);
+        }
+    } catch (const std::exception& e) {
+        // the connection is closed once this returns; the others are served
+        std::cerr << "Server " << server_id_ << " dropped a connection: " << e.what() << std::endl;
+    }
+}
+
+void ParameterServer::serve() {
+    std::string location;
+    std::string address = server_addresses(*args_).at(server_id_);
+    auto transport = get_transport(address, location);
+    listener_ = transport->listen(location);
+    std::cerr << "Server " << server_id_ << " listening on " << address << std::endl;
+    std::vector<std::thread> threads;
+    while (!shutdown_) {
+        auto connection = listener_->accept();
+        if (!connection) {
+            break;
+        }
+        threads.push_back(std::thread([=]() { handle(connection); }));
+    }
+    // serve the remaining requests of connected workers, until they hang up
+    for (auto it = threads.begin(); it != threads.end(); ++it) {
+        it->join();
+    }
+}
+
+ParameterClient::ParameterClient(std::shared_ptr<Args> args, int64_t num_rows) : args_(args) {
+    for (auto& address : server_addresses(*args_)) {
+        std::string location;
+        auto transport = get_transport(address, location);
+        servers_.push_back(transport->connect(location, CONNECT_TIMEOUT_SECS));
+    }
+    requests_.resize(servers_.size());
+    Message hello;
+    hello.type = uint32_t(message_type::hello);
+    hello.ids.push_back(num_rows);
+    hello.ids.push_back(args_->dimension);
+    for (auto& server : servers_) {
+        server->send(hello);
+    }
+    for (int32_t s = 0; s < servers_.size(); s++) {
+        await(s, reply_);
+    }
+}
+
+void ParameterClient::split(const std::vector<int32_t>& ids, message_type type) {
+    for (auto& request : requests_) {
+        request.type = uint32_t(type);
+        request.ids.clear();
+        request.data.clear();
+    }
+    for (auto id : ids) {
+        requests_[id % servers_.size()].ids.push_back(id);
+    }
+}
+
+void ParameterClient::await(int32_t s, Message& reply) {
+    if (!servers_[s]->receive(reply)) {
+        throw std::runtime_error("Parameter server hung up");
+    }
+    if (reply.type == uint32_t(message_type::error)) {
+        throw std::runtime_error("Parameter server " + std::to_string(s) + " refused a request");
+    }
+}
+
+void ParameterClient::pull(const std::vector<int32_t>& ids, std::vector<Vector>& rows) {
+    split(ids, message_type::pull);
+    int32_t num_servers = servers_.size();
+    int64_t dim = args_->dimension;
+    for (int32_t s = 0; s < num_servers; s++) {
+        servers_[s]->send(requests_[s]);
+    }
+    // the rows of each server arrive in the order they were requested
+    std::vector<int32_t> next(num_servers, 0);
+    for (int32_t s = 0; s < num_servers; s++) {
+        await(s, requests_[s]);
+    }
+    for (size_t n = 0; n < ids.size(); n++) {
+        int32_t s = ids[n] % num_servers;
+        auto begin = requests_[s].data.begin() + int64_t(next[s]++) * dim;
+        std::copy(begin, begin + dim, rows[n].data_);
+    }
+}
+
+void ParameterClient::push(const std::vector<int32_t>& ids, const std::vector<Vector>& tangents) {
+    split(ids, message_type::push);
+    int32_t num_servers = servers_.size();
+    for (size_t n = 0; n < ids.size(); n++) {
+        auto& data = requests_[ids[n] % num_servers].data;
+        data.insert(data.end(), tangents[n].data_, tangents[n].data_ + args_->dimension);
+    }
+    for (int32_t s = 0; s < num_servers; s++) {
+        servers_[s]->send(requests_[s]);
+    }
+    for (int32_t s = 0; s < num_servers; s++) {
+        await(s, reply_);
+    }
+}
+
+void ParameterClient::barrier() {
+    Message message;
+    message.type = uint32_t(message_type::barrier);
+    servers_[0]->send(message);
+    await(0, reply_);
+}
+
+void ParameterClient::shutdown() {
+    Message message;
+    message.type = uint32_t(message_type::shutdown);
+    for (int32_t s = 0; s < servers_.size(); s++) {
+        servers_[s]->send(message);
+        await(s, reply_);
+    }
+}
+
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "args.h"
+#include "model.h"
+#include "transport.h"
+#include "utils.h"
+#include "vector.h"
+
+namespace minkowski {
+
+/*
+ * The types of messages of the parameter server protocol.  Rows are sharded
+ * across the servers by id modulo the number of servers.
+ *  hello:    worker -> server, ids = {number of rows, dimension}; answered
+ *            by ack
+ *  pull:     worker -> server, ids = rows requested; answered by rows
+ *  rows:     server -> worker, data = the rows requested, concatenated
+ *  push:     worker -> server, ids = rows, data = a tangent vector for each
+ *            row (at the row's pulled value); answered by ack
+ *  barrier:  worker -> server 0; answered by ack once all workers have sent it
+ *  shutdown: worker -> server; the server stops serving
+ *  error:    server -> worker, in answer to an invalid request (whose reason
+ *            the server logs)
+ */
+enum class message_type : uint32_t { hello = 1, pull, rows, push, ack, barrier, shutdown, error };
+
+/*
+ * Return the addresses listed in -servers.
+ */
+std::vector<std::string> server_addresses(const Args& args);
+
+/*
+ * Holds one shard of the rows of the embedding matrix, and serves pulls of
+ * and pushes to these rows until shut down.  Pushed tangent vectors are
+ * applied with the geodesic update of Model::update.
+ */
+class ParameterServer {
+protected:
+    std::shared_ptr<Args> args_;
+    int32_t server_id_;
+    int32_t num_servers_;
+
+    // row with id i is at position i / num_servers_
+    std::shared_ptr<std::vector<Vector>> vectors_;
+    std::shared_ptr<std::vector<std::mutex>> vector_flags_;
+    int64_t num_rows_;
+    std::mutex init_mutex_;
+
+    std::shared_ptr<Listener> listener_;
+    std::shared_ptr<utils::Barrier> barrier_;
+    std::atomic<bool> shutdown_;
+
+    /*
+     * Allocate and randomly initialise the shard, if this hasn't happened
+     * yet, for a matrix with the specified number of rows.  Throws
+     * invalid_argument if it was initialised for another number.
+     */
+    void initialise(int64_t num_rows);
+
+    /*
+     * Return the position in the shard of the row with the specified id.
+     * Throws invalid_argument if the row is not one of this server's.
+     */
+    int64_t position(int32_t id) const;
+
+    /*
+     * Populate `reply` with the answer to `request`, from a connection whose
+     * model (once it has said hello) is `model`.  Throws invalid_argument if
+     * the request is invalid, in which case no row has been changed.
+     */
+    void answer(const Message& request, Message& reply, std::unique_ptr<Model>& model);
+
+    /*
+     * Answer the messages arriving on the connection, until it is closed.
+     * Invalid requests are answered with an error; should anything else go
+     * wrong, the connection is closed, but the server keeps serving.
+     */
+    void handle(std::shared_ptr<Connection> connection);
+
+public:
+    explicit ParameterServer(std::shared_ptr<Args> args);
+
+    /*
+     * Listen on the address of this server, and serve until shut down.
+     */
+    void serve();
+};
+
+/*
+ * The worker's end of the parameter server protocol: one connection to each
+ * of the servers.  Requests for rows on different servers are sent before
+ * any reply is awaited.
+ */
+class ParameterClient {
+protected:
+    std::shared_ptr<Args> args_;
+    std::vector<std::shared_ptr<Connection>> servers_;
+    std::vector<Message> requests_;
+    Message reply_;
+
+    /*
+     * Distribute the provided ids across the requests_ of the corresponding
+     * servers, each of the specified type.
+     */
+    void split(const std::vector<int32_t>& ids, message_type type);
+
+    /*
+     * Receive the reply of server `s` into `reply`.  Throws runtime_error if
+     * the server hung up or refused the request.
+     */
+    void await(int32_t s, Message& reply);
+
+public:
+    /*
+     * Connect to all servers, announcing the number of rows of the matrix.
+     */
+    ParameterClient(std::shared_ptr<Args> args, int64_t num_rows);
+
+    /*
+     * Populate rows[i] with the current value of the row with id ids[i].
+     * Pre: `rows` has at least as many entries as `ids`.
+     */
+    void pull(const std::vector<int32_t>& ids, std::vector<Vector>& rows);
+
+    /*
+     * Apply the tangent vectors tangents[i] to the rows with id ids[i], and
+     * wait for the servers to acknowledge.
+     */
+    void push(const std::vector<int32_t>& ids, const std::vector<Vector>& tangents);
+
+    /*
+     * Block until all workers (-workers) have called this function.
+     */
+    void barrier();
+
+    /*
+     * Stop all servers.
+     */
+    void shutdown();
+};
+
+}
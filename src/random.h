@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+
+#include "real.h"
+
+namespace minkowski {
+
+/*
+ * The xoshiro256** generator of Blackman & Vigna: 256 bits of state, 64-bit
+ * output, and only shifts, rotations and additions per draw (no modulo).
+ * Satisfies the requirements of a UniformRandomBitGenerator, so can also be
+ * used with the <random> distributions.
+ */
+class Rng {
+protected:
+    uint64_t state_[4];
+
+    static inline uint64_t rotl(uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+
+public:
+    typedef uint64_t result_type;
+
+    /*
+     * Seed the state by expanding `seed` with splitmix64, as recommended.
+     */
+    explicit Rng(uint64_t seed) {
+        for (int i = 0; i < 4; i++) {
+            seed += 0x9E3779B97F4A7C15ull;
+            uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            state_[i] = z ^ (z >> 31);
+        }
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT64_MAX; }
+
+    inline result_type operator()() {
+        uint64_t result = rotl(state_[1] * 5, 7) * 9;
+        uint64_t t = state_[1] << 17;
+        state_[2] ^= state_[0];
+        state_[3] ^= state_[1];
+        state_[1] ^= state_[2];
+        state_[0] ^= state_[3];
+        state_[2] ^= t;
+        state_[3] = rotl(state_[3], 45);
+        return result;
+    }
+
+    /*
+     * Return an integer uniformly distributed in [0, n), using the
+     * multiply-shift reduction of a 32-bit draw in place of a modulo.
+     */
+    inline uint32_t below(uint32_t n) {
+        return uint32_t(((operator()() >> 32) * uint64_t(n)) >> 32);
+    }
+
+    /*
+     * Return a real uniformly distributed in [0, 1).
+     */
+    inline real uniform() {
+        return real(operator()() >> 11) * (1. / 9007199254740992.);
+    }
+
+    /*
+     * Return a sample from the normal distribution with mean zero and the
+     * specified standard deviation (Box-Muller).
+     */
+    inline real normal(real std_dev) {
+        real u = 1. - uniform(); // in (0, 1], so the log is finite
+        real v = uniform();
+        return std_dev * std::sqrt(-2. * std::log(u)) * std::cos(6.283185307179586 * v);
+    }
+};
+
+/*
+ * The counter-based Philox4x32-10 generator of Salmon et al.  Random values
+ * are a pure function of the key and a 128-bit counter, so that randomness
+ * can be addressed by position (e.g. by the epoch and the offset of a token in
+ * the corpus) rather than depending on how many draws a thread has made.
+ * Each evaluation produces a block of four 32-bit values.
+ */
+class Philox {
+protected:
+    uint32_t key_[2];
+
+    static inline void mulhilo(uint32_t a, uint32_t b, uint32_t& hi, uint32_t& lo) {
+        uint64_t product = uint64_t(a) * uint64_t(b);
+        hi = uint32_t(product >> 32);
+        lo = uint32_t(product);
+    }
+
+public:
+    Philox(uint32_t key0, uint32_t key1) {
+        key_[0] = key0;
+        key_[1] = key1;
+    }
+
+    /*
+     * Populate `out` with the block of four random values for the counter
+     * whose high and low 64-bit halves are provided.
+     */
+    inline void block(uint64_t counter_hi, uint64_t counter_lo, uint32_t out[4]) const {
+        uint32_t c[4] = {uint32_t(counter_lo), uint32_t(counter_lo >> 32),
+                         uint32_t(counter_hi), uint32_t(counter_hi >> 32)};
+        uint32_t k0 = key_[0];
+        uint32_t k1 = key_[1];
+        for (int round = 0; round < 10; round++) {
+            uint32_t hi0, lo0, hi1, lo1;
+            mulhilo(0xD2511F53, c[0], hi0, lo0);
+            mulhilo(0xCD9E8D57, c[2], hi1, lo1);
+            c[0] = hi1 ^ c[1] ^ k0;
+            c[1] = lo1;
+            c[2] = hi0 ^ c[3] ^ k1;
+            c[3] = lo0;
+            k0 += 0x9E3779B9;
+            k1 += 0xBB67AE85;
+        }
+        out[0] = c[0];
+        out[1] = c[1];
+        out[2] = c[2];
+        out[3] = c[3];
+    }
+};
+
+}
@@ -0,0 +1,280 @@
+#include "transport.h"
+
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+namespace minkowski {
+
+namespace {
+
+struct MessageHeader {
+    uint32_t type;
+    uint32_t reserved;
+    uint64_t num_ids;
+    uint64_t num_data;
+};
+
+std::runtime_error socket_error(const std::string& what) {
+    return std::runtime_error(what + ": " + strerror(errno));
+}
+
+/*
+ * A connection over a stream socket (of any address family).  Messages are
+ * sent as a fixed size header followed by the ids and data, in host byte
+ * order (so peers must share an architecture).
+ */
+class SocketConnection : public Connection {
+protected:
+    int fd_;
+
+    void write_all(const void* buffer, size_t length) {
+        const char* p = static_cast<const char*>(buffer);
+        while (length > 0) {
+            ssize_t written = ::send(fd_, p, length, MSG_NOSIGNAL);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                throw socket_error("Sending message failed");
+            }
+            p += written;
+            length -= written;
+        }
+    }
+
+    /*
+     * Return false if the connection was closed before anything was read.
+     */
+    bool read_all(void* buffer, size_t length) {
+        char* p = static_cast<char*>(buffer);
+        size_t total = length;
+        while (length > 0) {
+            ssize_t received = ::recv(fd_, p, length, 0);
+            if (received < 0) {
+                if (errno == EINTR) continue;
+                throw socket_error("Receiving message failed");
+            }
+            if (received == 0) {
+                if (length == total) return false;
+                throw std::runtime_error("Connection closed mid-message");
+            }
+            p += received;
+            length -= received;
+        }
+        return true;
+    }
+
+public:
+    explicit SocketConnection(int fd) : fd_(fd) {}
+
+    ~SocketConnection() {
+        ::close(fd_);
+    }
+
+    void send(const Message& message) override {
+        MessageHeader header = {message.type, 0, message.ids.size(), message.data.size()};
+        write_all(&header, sizeof(header));
+        write_all(message.ids.data(), message.ids.size() * sizeof(int32_t));
+        write_all(message.data.data(), message.data.size() * sizeof(real));
+    }
+
+    bool receive(Message& message) override {
+        MessageHeader header;
+        if (!read_all(&header, sizeof(header))) {
+            return false;
+        }
+        message.type = header.type;
+        message.ids.resize(header.num_ids);
+        message.data.resize(header.num_data);
+        if (!read_all(message.ids.data(), header.num_ids * sizeof(int32_t)) && header.num_ids > 0) {
+            throw std::runtime_error("Connection closed mid-message");
+        }
+        if (!read_all(message.data.data(), header.num_data * sizeof(real)) && header.num_data > 0) {
+            throw std::runtime_error("Connection closed mid-message");
+        }
+        return true;
+    }
+};
+
+class SocketListener : public Listener {
+protected:
+    int fd_;
+    std::string unlink_path_; // for unix sockets
+
+public:
+    SocketListener(int fd, const std::string& unlink_path) : fd_(fd), unlink_path_(unlink_path) {}
+
+    ~SocketListener() {
+        close();
+        ::close(fd_);
+    }
+
+    std::shared_ptr<Connection> accept() override {
+        while (true) {
+            int fd = ::accept(fd_, nullptr, nullptr);
+            if (fd >= 0) {
+                return std::make_shared<SocketConnection>(fd);
+            }
+            if (errno != EINTR) {
+                return nullptr; // closed
+            }
+        }
+    }
+
+    void close() override {
+        ::shutdown(fd_, SHUT_RDWR);
+        if (!unlink_path_.empty()) {
+            ::unlink(unlink_path_.c_str());
+            unlink_path_.clear();
+        }
+    }
+};
+
+/*
+ * Repeatedly call `attempt` (which returns a connected socket or -1) until
+ * it succeeds or the timeout expires.
+ */
+template <typename F>
+int connect_with_retries(F attempt, const std::string& location, int32_t timeout_secs) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(timeout_secs);
+    while (true) {
+        int fd = attempt();
+        if (fd >= 0) {
+            return fd;
+        }
+        if (std::chrono::steady_clock::now() > deadline) {
+            throw socket_error("Could not connect to " + location);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+}
+
+class TcpTransport : public Transport {
+protected:
+    static void split(const std::string& location, std::string& host, std::string& port) {
+        size_t colon = location.rfind(':');
+        if (colon == std::string::npos) {
+            throw std::invalid_argument("Expected <host>:<port>, got " + location);
+        }
+        host = location.substr(0, colon);
+        port = location.substr(colon + 1);
+    }
+
+public:
+    std::shared_ptr<Listener> listen(const std::string& location) override {
+        std::string host, port;
+        split(location, host, port);
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) {
+            throw socket_error("Creating socket failed");
+        }
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons(std::stoi(port));
+        if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(fd, 128) < 0) {
+            ::close(fd);
+            throw socket_error("Listening on " + location + " failed");
+        }
+        return std::make_shared<SocketListener>(fd, "");
+    }
+
+    std::shared_ptr<Connection> connect(const std::string& location, int32_t timeout_secs) override {
+        std::string host, port;
+        split(location, host, port);
+        int fd = connect_with_retries([&]() {
+            addrinfo hints;
+            memset(&hints, 0, sizeof(hints));
+            hints.ai_family = AF_INET;
+            hints.ai_socktype = SOCK_STREAM;
+            addrinfo* result;
+            if (getaddrinfo(host.c_str(), port.c_str(), &hints, &result) != 0) {
+                return -1;
+            }
+            int fd = ::socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+            if (fd >= 0 && ::connect(fd, result->ai_addr, result->ai_addrlen) < 0) {
+                ::close(fd);
+                fd = -1;
+            }
+            freeaddrinfo(result);
+            return fd;
+        }, location, timeout_secs);
+        // messages are already batched, so don't delay them further
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        return std::make_shared<SocketConnection>(fd);
+    }
+};
+
+class UnixTransport : public Transport {
+protected:
+    static sockaddr_un address(const std::string& path) {
+        sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(addr.sun_path)) {
+            throw std::invalid_argument("Socket path too long: " + path);
+        }
+        strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+        return addr;
+    }
+
+public:
+    std::shared_ptr<Listener> listen(const std::string& path) override {
+        sockaddr_un addr = address(path);
+        int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            throw socket_error("Creating socket failed");
+        }
+        ::unlink(path.c_str());
+        if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(fd, 128) < 0) {
+            ::close(fd);
+            throw socket_error("Listening on " + path + " failed");
+        }
+        return std::make_shared<SocketListener>(fd, path);
+    }
+
+    std::shared_ptr<Connection> connect(const std::string& path, int32_t timeout_secs) override {
+        sockaddr_un addr = address(path);
+        int fd = connect_with_retries([&]() {
+            int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+            if (fd >= 0 && ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+                ::close(fd);
+                fd = -1;
+            }
+            return fd;
+        }, path, timeout_secs);
+        return std::make_shared<SocketConnection>(fd);
+    }
+};
+
+}
+
+std::shared_ptr<Transport> get_transport(const std::string& address, std::string& location) {
+    size_t separator = address.find("://");
+    if (separator == std::string::npos) {
+        throw std::invalid_argument("Address without a scheme: " + address);
+    }
+    std::string scheme = address.substr(0, separator);
+    location = address.substr(separator + 3);
+    if (scheme == "tcp") {
+        return std::make_shared<TcpTransport>();
+    } else if (scheme == "unix") {
+        return std::make_shared<UnixTransport>();
+    }
+    throw std::invalid_argument("Unknown transport: " + scheme);
+}
+
+}
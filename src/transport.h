@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "real.h"
+
+namespace minkowski {
+
+/*
+ * A message exchanged over a Connection: a type (whose meaning is up to the
+ * protocol), a list of row ids and a flat array of row data.
+ */
+struct Message {
+    uint32_t type;
+    std::vector<int32_t> ids;
+    std::vector<real> data;
+};
+
+/*
+ * A bidirectional, reliable and ordered stream of messages.
+ */
+class Connection {
+public:
+    virtual ~Connection() {}
+
+    virtual void send(const Message&) = 0;
+
+    /*
+     * Block until the next message arrives, and store it in the provided
+     * message.  Return false if the peer has closed the connection.
+     */
+    virtual bool receive(Message&) = 0;
+};
+
+class Listener {
+public:
+    virtual ~Listener() {}
+
+    /*
+     * Block until a peer connects and return the connection, or nullptr if
+     * the listener has been closed.
+     */
+    virtual std::shared_ptr<Connection> accept() = 0;
+
+    /*
+     * Stop listening, causing any blocked call to accept to return.
+     */
+    virtual void close() = 0;
+};
+
+/*
+ * A means of establishing connections.  Addresses are of the form
+ * <scheme>://<location>, and each transport handles one scheme.
+ */
+class Transport {
+public:
+    virtual ~Transport() {}
+
+    virtual std::shared_ptr<Listener> listen(const std::string& location) = 0;
+
+    /*
+     * Connect to the specified location, retrying for up to `timeout_secs`
+     * seconds while no one is listening there.
+     */
+    virtual std::shared_ptr<Connection> connect(const std::string& location, int32_t timeout_secs) = 0;
+};
+
+/*
+ * Return the transport for the scheme of the provided address, and set
+ * `location` to the remainder of the address.  Supported are
+ * tcp://<host>:<port> and unix://<socket path> (for processes on the same
+ * machine).
+ */
+std::shared_ptr<Transport> get_transport(const std::string& address, std::string& location);
+
+}
@@ -1,20 +1,108 @@
 #include "utils.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
 #include <ios>
+#include <limits>
+#include <stdexcept>
 
 namespace minkowski {
 
 namespace utils {
 
-int64_t size(std::ifstream& ifs) {
+int64_t size(std::istream& ifs) {
     ifs.seekg(std::streamoff(0), std::ios::end);
     return ifs.tellg();
 }
 
-void seek(std::ifstream& ifs, int64_t pos) {
+void seek(std::istream& ifs, int64_t pos) {
     ifs.clear();
     ifs.seekg(std::streampos(pos));
 }
+
+int32_t format_real(real value, char* out) {
+    // as operator<< of Vector writes it, in the "C" locale the program runs in
+    return std::snprintf(out, MAX_REAL_CHARS, "%.*g", std::numeric_limits<real>::digits10 + 1, value);
+}
+
+MappedFile::MappedFile(const std::string& path) : data_(nullptr), size_(0) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::invalid_argument(path + " cannot be opened for mapping!");
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        throw std::invalid_argument(path + " cannot be opened for mapping!");
+    }
+    size_ = st.st_size;
+    if (size_ > 0) {
+        void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            throw std::invalid_argument(path + " cannot be mapped into memory!");
+        }
+        // read sequentially by each thread
+        madvise(data, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<const char*>(data);
+    }
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (data_ != nullptr) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+}
+
+MemoryStream::Buffer::Buffer(const char* begin, const char* end) {
+    char* b = const_cast<char*>(begin);
+    setg(b, b, const_cast<char*>(end));
+}
+
+MemoryStream::Buffer::pos_type MemoryStream::Buffer::seekoff(off_type off, std::ios_base::seekdir dir,
+                                                             std::ios_base::openmode which) {
+    char* base;
+    if (dir == std::ios_base::beg) {
+        base = eback();
+    } else if (dir == std::ios_base::cur) {
+        base = gptr();
+    } else {
+        base = egptr();
+    }
+    if (!(which & std::ios_base::in) || base + off < eback() || base + off > egptr()) {
+        return pos_type(off_type(-1));
+    }
+    setg(eback(), base + off, egptr());
+    return pos_type(gptr() - eback());
+}
+
+MemoryStream::Buffer::pos_type MemoryStream::Buffer::seekpos(pos_type pos, std::ios_base::openmode which) {
+    return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+
+MemoryStream::MemoryStream(const char* begin, const char* end) :
+    std::istream(nullptr), buffer_(begin, end) {
+    rdbuf(&buffer_);
+}
+
+Barrier::Barrier(int32_t count) : count_(count), waiting_(0), generation_(0) {}
+
+void Barrier::wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    int64_t generation = generation_;
+    if (++waiting_ == count_) {
+        waiting_ = 0;
+        generation_++;
+        cv_.notify_all();
+    } else {
+        cv_.wait(lock, [&]() { return generation != generation_; });
+    }
+}
 }
 
 }
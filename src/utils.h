@@ -1,13 +1,107 @@
 #pragma once
 
 #include <fstream>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <condition_variable>
+
+#include "real.h"
 
 namespace minkowski {
 
 namespace utils {
 
-  int64_t size(std::ifstream&);
-  void seek(std::ifstream&, int64_t);
+  int64_t size(std::istream&);
+  void seek(std::istream&, int64_t);
+
+  /*
+   * Read or write a value in its binary representation (in the byte order of
+   * the machine).
+   */
+  template<typename T>
+  void read_value(std::istream& in, T& value) {
+      in.read(reinterpret_cast<char*>(&value), sizeof(T));
+  }
+
+  template<typename T>
+  void write_value(std::ostream& out, const T& value) {
+      out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  /*
+   * The most characters that format_real writes, with the terminating null.
+   */
+  constexpr int32_t MAX_REAL_CHARS = 32;
+
+  /*
+   * Write `value`, null-terminated, to `out`, as operator<< of Vector does
+   * (%g at precision digits10 + 1), and return its length.
+   */
+  int32_t format_real(real value, char* out);
+
+  /*
+   * A file mapped read-only into memory, for the lifetime of the object.
+   */
+  class MappedFile {
+  protected:
+      const char* data_;
+      int64_t size_;
+
+  public:
+      /*
+       * Map the file at `path`; throws invalid_argument if it can't be.
+       */
+      explicit MappedFile(const std::string& path);
+      ~MappedFile();
+      MappedFile(const MappedFile&) = delete;
+      MappedFile& operator=(const MappedFile&) = delete;
+
+      const char* data() const { return data_; }
+      int64_t size() const { return size_; }
+  };
+
+  /*
+   * A seekable input stream over a range of memory (e.g. a MappedFile),
+   * which it does not copy.
+   */
+  class MemoryStream : public std::istream {
+  protected:
+      class Buffer : public std::streambuf {
+      public:
+          Buffer(const char* begin, const char* end);
+      protected:
+          pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+          pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+      };
+      Buffer buffer_;
+
+  public:
+      MemoryStream(const char* begin, const char* end);
+  };
+
+  /*
+   * A reusable barrier for a fixed number of threads.
+   */
+  class Barrier {
+  protected:
+      std::mutex mutex_;
+      std::condition_variable cv_;
+      int32_t count_;
+      int32_t waiting_;
+      int64_t generation_;
+
+  public:
+      explicit Barrier(int32_t count);
+
+      /*
+       * Block until `count` threads (including this one) have called wait.
+       */
+      void wait();
+  };
 }
 
 }
@@ -1,8 +1,8 @@
 #include "vector.h"
 
-#include <random>
 #include <cmath>
 #include <assert.h>
+#include <algorithm>
 
 #include <iomanip>
 #include <cmath>
@@ -126,15 +126,48 @@ std::ostream& operator<<(std::ostream& os, const Vector& v) {
     return os;
 }
 
-void random_hyperboloid_point(Vector& vector, std::minstd_rand& rng, real std_dev) {
-    std::normal_distribution<> normal_dist(0, std_dev);
+void minkowski_gemm(const real* a, const real* b, real* c, int64_t m, int64_t k, int64_t n) {
+    for (int64_t i = 0; i < m; i++) {
+        const real* a_row = a + i * n;
+        int64_t j = 0;
+        // four rows of b at a time, so that each entry of a is loaded once
+        for (; j + 4 <= k; j += 4) {
+            const real* b0 = b + j * n;
+            const real* b1 = b0 + n;
+            const real* b2 = b1 + n;
+            const real* b3 = b2 + n;
+            real c0 = 0, c1 = 0, c2 = 0, c3 = 0;
+            for (int64_t l = 0; l < n - 1; l++) {
+                c0 += a_row[l] * b0[l];
+                c1 += a_row[l] * b1[l];
+                c2 += a_row[l] * b2[l];
+                c3 += a_row[l] * b3[l];
+            }
+            real t = a_row[n - 1];
+            c[i * k + j] = c0 - t * b0[n - 1];
+            c[i * k + j + 1] = c1 - t * b1[n - 1];
+            c[i * k + j + 2] = c2 - t * b2[n - 1];
+            c[i * k + j + 3] = c3 - t * b3[n - 1];
+        }
+        for (; j < k; j++) {
+            const real* b_row = b + j * n;
+            real result = 0;
+            for (int64_t l = 0; l < n - 1; l++) {
+                result += a_row[l] * b_row[l];
+            }
+            c[i * k + j] = result - a_row[n - 1] * b_row[n - 1];
+        }
+    }
+}
+
+void random_hyperboloid_point(Vector& vector, Rng& rng, real std_dev) {
     int64_t n = vector.size();
     // sample a tangent vector at the basepoint from a normal
     // distribution, i.e. sample the first dimension_-1 components
     Vector tangent(n);
     real tangent_norm = 0;
     for (int64_t j = 0; j < n - 1; ++j) {
-        tangent[j] = normal_dist(rng);
+        tangent[j] = rng.normal(std_dev);
         tangent_norm += tangent[j] * tangent[j];
     }
     tangent[n - 1] = 0;
@@ -145,6 +178,25 @@ void random_hyperboloid_point(Vector& vector, std::minstd_rand& rng, real std_de
     vector.geodesic_update(tangent, tangent_norm);
 }
 
+void lorentzian_centroid(const std::vector<const Vector*>& points, Vector& centroid) {
+    centroid.zero();
+    for (auto point : points) {
+        centroid.add(*point);
+    }
+    centroid.ensure_on_hyperboloid();
+}
+
+void log_map(const Vector& base, const Vector& point, Vector& tangent) {
+    real cosh_dist = std::max(-minkowski_dot(base, point), real(1.));
+    // project onto the tangent space at base: this has length sinh(dist)
+    tangent = point;
+    tangent.project_onto_tangent_space(base);
+    real dist = std::acosh(cosh_dist);
+    if (dist > MDP_ERROR_TOLERANCE) {
+        tangent.multiply(dist / std::sinh(dist));
+    }
+}
+
 real distance(const Vector& point0, const Vector& point1) {
     return std::acosh(-minkowski_dot(point0, point1));
 }
@@ -2,9 +2,10 @@
 
 #include <cstdint>
 #include <ostream>
-#include <random>
+#include <vector>
 #include <assert.h>
 
+#include "random.h"
 #include "real.h"
 
 namespace minkowski {
@@ -109,12 +110,32 @@ inline real minkowski_dot(const Vector& v, const Vector& w) {
     return result;
 }
 
+/*
+ * Compute the matrix of Minkowski inner products of the rows of `a` (m x n)
+ * with the rows of `b` (k x n), i.e. c = a G b^T where G = diag(1, ..., 1, -1),
+ * storing the result in `c` (m x k).  All matrices are dense and row-major.
+ */
+void minkowski_gemm(const real* a, const real* b, real* c, int64_t m, int64_t k, int64_t n);
+
 /*
  * Sample from points on the hyperboloid distributed circularly
  * around the base point with the hyperbolic distance from the base
  * point normally distributed with standard deviation std_dev.
  */
-void random_hyperboloid_point(Vector& vector, std::minstd_rand& rng, real std_dev);
+void random_hyperboloid_point(Vector& vector, Rng& rng, real std_dev);
+
+/*
+ * Set `centroid` to the Lorentzian centroid of the provided points on the
+ * hyperboloid, i.e. to their sum, projected back onto the hyperboloid.
+ */
+void lorentzian_centroid(const std::vector<const Vector*>& points, Vector& centroid);
+
+/*
+ * Set `tangent` to the tangent vector at `base` that points along the
+ * geodesic to `point` and whose length is their distance, i.e. to the
+ * inverse of the exponential map (see Vector::geodesic_update).
+ */
+void log_map(const Vector& base, const Vector& point, Vector& tangent);
 
 /*
  * Return the distance between the two points on the hyperboloid.
@@ -0,0 +1,160 @@
+#include "vector_delta.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+#include "dictionary.h"
+#include "utils.h"
+#include "vector_file.h"
+
+namespace minkowski {
+
+using utils::read_value;
+using utils::write_value;
+
+constexpr int32_t VECTOR_DELTA_MAGIC = 0x4d4b444c; // "MKDL"
+constexpr int32_t VECTOR_DELTA_VERSION = 1;
+constexpr int32_t DTYPE_REAL = sizeof(real) == 8 ? 1 : 2;
+
+static_assert(sizeof(VectorDeltaHeader) == 48, "the header is 48 bytes");
+
+bool VectorDelta::is_delta(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    int32_t magic = 0;
+    read_value(in, magic);
+    return in && magic == VECTOR_DELTA_MAGIC;
+}
+
+VectorDelta::VectorDelta(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        throw std::invalid_argument(path + " cannot be opened for compaction!");
+    }
+    const int64_t file_size = utils::size(in);
+    utils::seek(in, 0);
+    VectorDeltaHeader header = VectorDeltaHeader();
+    read_value(in, header);
+    if (!in || header.magic != VECTOR_DELTA_MAGIC || header.version != VECTOR_DELTA_VERSION) {
+        throw std::invalid_argument(path + " is not a delta checkpoint (see -checkpoint-deltas).");
+    }
+    if (header.dtype != DTYPE_REAL) {
+        throw std::invalid_argument(path + " has coordinates of another type.");
+    }
+    if (header.dimension < 1 || header.num_rows < 0 || header.base_length < 0 ||
+            int64_t(sizeof(header)) + header.base_length +
+            header.num_rows * int64_t(sizeof(int64_t) + header.dimension * sizeof(real)) != file_size) {
+        throw std::invalid_argument(path + " is truncated.");
+    }
+    count = header.count;
+    dimension = header.dimension;
+    base.resize(header.base_length);
+    in.read(&base[0], base.size());
+    ids.resize(header.num_rows);
+    in.read(reinterpret_cast<char*>(ids.data()), ids.size() * sizeof(int64_t));
+    rows.resize(header.num_rows * dimension);
+    in.read(reinterpret_cast<char*>(rows.data()), rows.size() * sizeof(real));
+    for (auto id : ids) {
+        if (id < 0 || id >= count) {
+            throw std::invalid_argument(path + " has a row out of range.");
+        }
+    }
+}
+
+void VectorDelta::write(std::ostream& out, const std::string& base, const std::vector<Vector>& vectors,
+                        const std::vector<uint8_t>& changed, int64_t count, int64_t dimension) {
+    VectorDeltaHeader header = VectorDeltaHeader();
+    header.magic = VECTOR_DELTA_MAGIC;
+    header.version = VECTOR_DELTA_VERSION;
+    header.count = count;
+    header.dimension = dimension;
+    header.dtype = DTYPE_REAL;
+    header.num_rows = std::count(changed.begin(), changed.begin() + count, 1);
+    header.base_length = base.size();
+    write_value(out, header);
+    out.write(base.data(), base.size());
+    for (int64_t i = 0; i < count; i++) {
+        if (changed[i]) {
+            write_value(out, i);
+        }
+    }
+    for (int64_t i = 0; i < count; i++) {
+        if (changed[i]) {
+            out.write(reinterpret_cast<const char*>(vectors[i].data_), dimension * sizeof(real));
+        }
+    }
+}
+
+DeltaCompactor::DeltaCompactor(std::shared_ptr<Args> args) : args_(args) {}
+
+void DeltaCompactor::compact() {
+    // the deltas, from the last back to the first
+    std::vector<VectorDelta> deltas;
+    std::set<std::string> seen;
+    std::string path = args_->input;
+    while (VectorDelta::is_delta(path)) {
+        if (!seen.insert(path).second) {
+            throw std::invalid_argument("The chain of deltas of " + args_->input + " has a cycle.");
+        }
+        deltas.emplace_back(path);
+        // the base is in the same directory
+        path = path.substr(0, path.find_last_of('/') + 1) + deltas.back().base;
+    }
+
+    std::vector<entry> words;
+    std::vector<Vector> vectors;
+    int64_t dimension = deltas.empty() ? args_->dimension : deltas.front().dimension;
+    const std::string dimension_error = path + " does not have vectors of dimension " +
+                                        std::to_string(dimension) + ".";
+    utils::MappedFile file(path);
+    if (VectorFile::is_vector_file(file.data(), file.data() + file.size())) {
+        VectorFile base(file.data(), file.data() + file.size());
+        if (base.dimension() != dimension) {
+            throw std::invalid_argument(dimension_error);
+        }
+        for (int64_t row = 0; row < base.count(); row++) {
+            words.push_back(entry{base.word(row), 0});
+            vectors.push_back(Vector(dimension));
+            std::copy(base.vector(row), base.vector(row) + dimension, vectors.back().data_);
+        }
+    } else {
+        utils::MemoryStream ifs(file.data(), file.data() + file.size());
+        std::string line, word;
+        while (std::getline(ifs, line)) {
+            std::istringstream fields(line);
+            if (!(fields >> word)) {
+                continue;
+            }
+            words.push_back(entry{word, 0});
+            vectors.push_back(Vector(dimension));
+            for (int64_t i = 0; i < dimension; i++) {
+                if (!(fields >> vectors.back()[i])) {
+                    throw std::invalid_argument(dimension_error);
+                }
+            }
+        }
+    }
+
+    int64_t num_rows = 0;
+    for (auto delta = deltas.rbegin(); delta != deltas.rend(); ++delta) {
+        if (delta->count != vectors.size() || delta->dimension != dimension) {
+            throw std::invalid_argument("A delta of " + args_->input + " does not match the vectors of " + path + ".");
+        }
+        for (size_t k = 0; k < delta->ids.size(); k++) {
+            const real* row = &delta->rows[k * dimension];
+            std::copy(row, row + dimension, vectors[delta->ids[k]].data_);
+        }
+        num_rows += delta->ids.size();
+    }
+    std::cerr << "Applied " << deltas.size() << " deltas, of " << num_rows << " rows, to the "
+              << vectors.size() << " vectors of " << path << std::endl;
+
+    Args args = *args_;
+    args.dimension = dimension;
+    VectorFile::save(args_->output, words, vectors, vectors.size(), args, args_->threads);
+}
+
+}
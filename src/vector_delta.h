@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "args.h"
+#include "real.h"
+#include "vector.h"
+
+namespace minkowski {
+
+/*
+ * The header of a delta checkpoint: the rows of the vectors that changed
+ * since a previous checkpoint, its base.  It is followed by the file name of
+ * the base (which is in the same directory), the int64 id of each row, in
+ * increasing order, and the rows.  Numbers are stored in the byte order of
+ * the machine.
+ */
+struct VectorDeltaHeader {
+    int32_t magic;
+    int32_t version;
+    int64_t count;           // number of rows of the vectors (not of the delta)
+    int64_t dimension;
+    int32_t dtype;           // of the coordinates, as in a vector file
+    int32_t reserved;
+    int64_t num_rows;        // in the delta
+    int64_t base_length;     // of the file name of the base
+};
+
+/*
+ * A delta checkpoint, read into memory.
+ */
+class VectorDelta {
+public:
+    std::string base;
+    int64_t count;
+    int64_t dimension;
+    std::vector<int64_t> ids;
+    std::vector<real> rows;  // one after the other
+
+    /*
+     * Read the delta checkpoint at `path`.  Throws invalid_argument if it
+     * can't be read, or is not a delta checkpoint.
+     */
+    explicit VectorDelta(const std::string& path);
+
+    /*
+     * Return whether the file at `path` starts as a delta checkpoint does.
+     */
+    static bool is_delta(const std::string& path);
+
+    /*
+     * Write the first `count` vectors that are marked in `changed` as a
+     * delta of the checkpoint whose file name is `base`.
+     */
+    static void write(std::ostream& out, const std::string& base, const std::vector<Vector>& vectors,
+                      const std::vector<uint8_t>& changed, int64_t count, int64_t dimension);
+};
+
+/*
+ * Merges a chain of delta checkpoints into full vectors.
+ */
+class DeltaCompactor {
+protected:
+    std::shared_ptr<Args> args_;
+
+public:
+    explicit DeltaCompactor(std::shared_ptr<Args> args);
+
+    /*
+     * Follow the delta checkpoint -input back to the full checkpoint that
+     * its chain starts from (a .csv or .bin output), apply the deltas to it
+     * in order, and save the vectors to -output, as per -output-format.
+     */
+    void compact();
+};
+
+}
@@ -0,0 +1,152 @@
+#include "vector_file.h"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+
+#include "utils.h"
+
+namespace minkowski {
+
+constexpr int32_t VECTOR_FILE_MAGIC = 0x4d4b5643; // "MKVC"
+constexpr int32_t VECTOR_FILE_VERSION = 1;
+constexpr int32_t DTYPE_FLOAT64 = 1;
+constexpr int32_t DTYPE_FLOAT32 = 2;
+constexpr int32_t DTYPE_REAL = sizeof(real) == 8 ? DTYPE_FLOAT64 : DTYPE_FLOAT32;
+
+// coordinates formatted by a thread into its buffer at a time
+constexpr int64_t CSV_BLOCK_VALUES = 1 << 18;
+
+static_assert(sizeof(VectorFileHeader) == 64, "the header is 64 bytes");
+
+bool VectorFile::is_vector_file(const char* begin, const char* end) {
+    return end - begin >= int64_t(sizeof(VectorFileHeader)) &&
+           reinterpret_cast<const VectorFileHeader*>(begin)->magic == VECTOR_FILE_MAGIC;
+}
+
+VectorFile::VectorFile(const char* begin, const char* end) {
+    if (!is_vector_file(begin, end)) {
+        throw std::invalid_argument("Not a vector file (see -output-format).");
+    }
+    header_ = reinterpret_cast<const VectorFileHeader*>(begin);
+    if (header_->version != VECTOR_FILE_VERSION) {
+        throw std::invalid_argument("Unsupported version of the vector file.");
+    }
+    if (header_->dtype != DTYPE_REAL) {
+        throw std::invalid_argument("The vector file has coordinates of another type.");
+    }
+    // every offset and size is checked against the file before it is used, in
+    // an order that cannot overflow
+    const int64_t size = end - begin;
+    const int64_t count = header_->count;
+    const int64_t dimension = header_->dimension;
+    if (header_->file_size != size || count < 0 || dimension < 1 ||
+            header_->strings_offset < int64_t(sizeof(VectorFileHeader)) ||
+            header_->strings_offset % int64_t(sizeof(int64_t)) != 0 || header_->strings_offset > size ||
+            count > (size - header_->strings_offset) / int64_t(sizeof(int64_t)) ||
+            header_->matrix_offset < header_->strings_offset + count * int64_t(sizeof(int64_t)) ||
+            header_->matrix_offset % int64_t(sizeof(real)) != 0 || header_->matrix_offset > size ||
+            (count > 0 && (size - header_->matrix_offset) / int64_t(sizeof(real)) / dimension < count)) {
+        throw std::invalid_argument("Truncated vector file.");
+    }
+    ends_ = reinterpret_cast<const int64_t*>(begin + header_->strings_offset);
+    chars_ = reinterpret_cast<const char*>(ends_ + count);
+    matrix_ = reinterpret_cast<const real*>(begin + header_->matrix_offset);
+    // each word ends where the next starts, before the matrix
+    const int64_t chars_size = reinterpret_cast<const char*>(matrix_) - chars_;
+    for (int64_t row = 0; row < count; row++) {
+        if (ends_[row] < (row > 0 ? ends_[row - 1] : 0) || ends_[row] > chars_size) {
+            throw std::invalid_argument("Corrupt string table in the vector file.");
+        }
+    }
+}
+
+void VectorFile::write(std::ostream& out, const std::vector<entry>& words,
+                       const std::vector<Vector>& vectors, int64_t count, const Args& args) {
+    VectorFileHeader header = VectorFileHeader();
+    header.magic = VECTOR_FILE_MAGIC;
+    header.version = VECTOR_FILE_VERSION;
+    header.count = count;
+    header.dimension = args.dimension;
+    header.dtype = DTYPE_REAL;
+    header.model = int32_t(args.model);
+    header.loss = int32_t(args.loss);
+    header.strings_offset = sizeof(VectorFileHeader);
+    std::vector<int64_t> ends(count);
+    int64_t end = 0;
+    for (int64_t i = 0; i < count; i++) {
+        end += words[i].word.size();
+        ends[i] = end;
+    }
+    int64_t strings_end = header.strings_offset + count * int64_t(sizeof(int64_t)) + end;
+    header.matrix_offset = (strings_end + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    header.file_size = header.matrix_offset + count * args.dimension * int64_t(sizeof(real));
+
+    utils::write_value(out, header);
+    out.write(reinterpret_cast<const char*>(ends.data()), count * sizeof(int64_t));
+    for (int64_t i = 0; i < count; i++) {
+        out.write(words[i].word.data(), words[i].word.size());
+    }
+    const char padding[ALIGNMENT] = {};
+    out.write(padding, header.matrix_offset - strings_end);
+    for (int64_t i = 0; i < count; i++) {
+        out.write(reinterpret_cast<const char*>(vectors[i].data_), args.dimension * sizeof(real));
+    }
+}
+
+void VectorFile::write_csv(std::ostream& out, const std::vector<entry>& words,
+                           const std::vector<Vector>& vectors, int64_t count, int64_t dimension, int32_t threads) {
+    const int64_t block_rows = std::max(CSV_BLOCK_VALUES / dimension, int64_t(1));
+    std::vector<std::string> buffers(threads);
+    auto format = [&](int32_t thread_id, int64_t begin, int64_t end) {
+        std::string& buffer = buffers[thread_id];
+        buffer.clear();
+        char number[utils::MAX_REAL_CHARS];
+        for (int64_t i = begin; i < end; i++) {
+            buffer += words[i].word;
+            const real* row = vectors[i].data_;
+            for (int64_t j = 0; j < dimension; j++) {
+                buffer += ' ';
+                buffer.append(number, utils::format_real(row[j], number));
+            }
+            buffer += '\n';
+        }
+    };
+    for (int64_t start = 0; start < count; start += block_rows * threads) {
+        std::vector<std::thread> workers;
+        for (int32_t t = 1; t < threads; t++) {
+            int64_t begin = std::min(start + t * block_rows, count);
+            workers.push_back(std::thread(format, t, begin, std::min(begin + block_rows, count)));
+        }
+        format(0, start, std::min(start + block_rows, count));
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        for (auto& buffer : buffers) {
+            out.write(buffer.data(), buffer.size());
+        }
+    }
+}
+
+void VectorFile::save(const std::string& fn, const std::vector<entry>& words,
+                      const std::vector<Vector>& vectors, int64_t count, const Args& args, int32_t threads) {
+    if (args.output_format != output_format_name::bin) {
+        std::ofstream ofs(fn + ".csv", std::ios::binary);
+        if (!ofs.is_open()) {
+            throw std::invalid_argument(fn + " cannot be opened for saving vectors!");
+        }
+        write_csv(ofs, words, vectors, count, args.dimension, threads);
+        ofs.close();
+    }
+    if (args.output_format != output_format_name::csv) {
+        std::ofstream ofs(fn + ".bin", std::ios::binary);
+        if (!ofs.is_open()) {
+            throw std::invalid_argument(fn + " cannot be opened for saving vectors!");
+        }
+        write(ofs, words, vectors, count, args);
+        ofs.close();
+    }
+}
+
+}
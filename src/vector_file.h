@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "args.h"
+#include "dictionary.h"
+#include "real.h"
+#include "vector.h"
+
+namespace minkowski {
+
+/*
+ * The header of a vector file.  It is followed by the string table, the
+ * int64 end offset of the characters of each word, in order of row, and
+ * their characters, then, at the next multiple of VectorFile::ALIGNMENT
+ * bytes, the matrix of the vectors, row by row.  Numbers are stored in the
+ * byte order of the machine.
+ */
+struct VectorFileHeader {
+    int32_t magic;
+    int32_t version;
+    int64_t count;           // number of rows
+    int64_t dimension;
+    int32_t dtype;           // of the coordinates: 1 for float64, 2 for float32
+    int32_t model;           // the model_name the vectors were trained with
+    int32_t loss;            // and their loss_name
+    int32_t reserved;
+    int64_t strings_offset;  // of the string table
+    int64_t matrix_offset;
+    int64_t file_size;
+};
+
+/*
+ * A vector file held in memory (e.g. a mapped file), which it does not copy.
+ */
+class VectorFile {
+protected:
+    const VectorFileHeader* header_;
+    const int64_t* ends_;
+    const char* chars_;
+    const real* matrix_;
+
+public:
+    static const int64_t ALIGNMENT = 64;
+
+    /*
+     * Read the vector file in [begin, end).  Throws invalid_argument if it is
+     * not a vector file, not one of coordinates of type `real`, or if its
+     * offsets do not fit in [begin, end).
+     */
+    VectorFile(const char* begin, const char* end);
+
+    /*
+     * Return whether [begin, end) starts as a vector file does.
+     */
+    static bool is_vector_file(const char* begin, const char* end);
+
+    /*
+     * Write the first `count` vectors, with the words of the same ids, as a
+     * vector file.
+     */
+    static void write(std::ostream& out, const std::vector<entry>& words,
+                      const std::vector<Vector>& vectors, int64_t count, const Args& args);
+
+    /*
+     * Write the first `count` vectors as text, a line of the word and the
+     * coordinates of each, separated by spaces, as operator<< of Vector
+     * writes them (see utils::format_real).  Blocks of rows are formatted on
+     * `threads` threads at a time, and written in order.
+     */
+    static void write_csv(std::ostream& out, const std::vector<entry>& words,
+                          const std::vector<Vector>& vectors, int64_t count, int64_t dimension, int32_t threads);
+
+    /*
+     * Save the first `count` vectors, with the words of the same ids, to
+     * <fn>.csv and/or to <fn>.bin, as a vector file, as per -output-format.
+     * The text is formatted on `threads` threads.
+     */
+    static void save(const std::string& fn, const std::vector<entry>& words,
+                     const std::vector<Vector>& vectors, int64_t count, const Args& args, int32_t threads);
+
+    int64_t count() const {
+        return header_->count;
+    }
+
+    int64_t dimension() const {
+        return header_->dimension;
+    }
+
+    std::string word(int64_t row) const {
+        int64_t start = row == 0 ? 0 : ends_[row - 1];
+        return std::string(chars_ + start, ends_[row] - start);
+    }
+
+    const real* vector(int64_t row) const {
+        return matrix_ + row * header_->dimension;
+    }
+};
+
+}
@@ -0,0 +1,173 @@
+#include "worker.h"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "parameter_server.h"
+
+// how many batches to process before reporting on performance
+constexpr int32_t REPORTING_INTERVAL = 5;
+
+// how many rows to collect per message when saving
+constexpr int32_t COLLECT_BATCH_SIZE = 10000;
+
+namespace minkowski {
+
+Worker::Worker(std::shared_ptr<Args> args) : Minkowski(args) {}
+
+void Worker::train() {
+    if (args_->worker_id < 0 || args_->worker_id >= args_->workers) {
+        throw std::invalid_argument("-worker-id must be between 0 and -workers - 1.");
+    }
+    if (args_->replicas != 1) {
+        throw std::invalid_argument("-replicas can not be combined with parameter servers.");
+    }
+    if (args_->lock_policy == lock_policy_name::scheduled) {
+        throw std::invalid_argument("-lock-policy scheduled can not be combined with parameter servers.");
+    }
+    if (args_->state_tokens > 0 || !args_->resume.empty()) {
+        throw std::invalid_argument("Training against parameter servers can not be saved and resumed.");
+    }
+    if (args_->model != model_name::skipgram || args_->loss != loss_name::ns ||
+            args_->input_format != input_format_name::text || !args_->init_vectors.empty()) {
+        throw std::invalid_argument("Workers only train the skipgram model with negative sampling, on a corpus, from random vectors.");
+    }
+    // all workers count the same corpus, so agree on the vocabulary
+    build_vocabulary();
+    burnin_ = true;
+    train_epochs(args_->burnin_epochs, args_->seed, args_->burnin_lr, args_->burnin_lr, false);
+    burnin_ = false;
+    train_epochs(args_->epochs, -1 * (args_->seed), args_->start_lr, args_->end_lr, false);
+
+    ParameterClient client(args_, dict_->nwords_);
+    client.barrier();
+    if (args_->worker_id == 0) {
+        vectors_ = std::make_shared<std::vector<Vector>>(dict_->nwords_, Vector(args_->dimension));
+        std::vector<int32_t> ids;
+        for (int32_t begin = 0; begin < dict_->nwords_; begin += COLLECT_BATCH_SIZE) {
+            ids.clear();
+            for (int32_t i = begin; i < std::min(begin + COLLECT_BATCH_SIZE, dict_->nwords_); i++) {
+                ids.push_back(i);
+            }
+            std::vector<Vector> rows(ids.size(), Vector(args_->dimension));
+            client.pull(ids, rows);
+            for (size_t n = 0; n < ids.size(); n++) {
+                vectors_->at(ids[n]) = rows[n];
+            }
+        }
+        save_vectors(args_->output);
+        client.shutdown();
+    }
+}
+
+void Worker::epoch_thread(int32_t thread_id, int32_t seed, int32_t epoch, real start_lr, real end_lr) {
+    // the corpus is divided between the threads of all workers
+    const int32_t shard = args_->worker_id * args_->threads + thread_id;
+    const int32_t num_shards = args_->workers * args_->threads;
+    Rng rng(seed + epoch * num_shards + shard);
+    Philox subsampling_rng(seed, epoch);
+    std::ifstream ifs(args_->input);
+    utils::seek(ifs, shard * utils::size(ifs) / num_shards);
+    ParameterClient client(args_, dict_->nwords_);
+
+    // local copies of the rows of the batch, as trained and as pulled
+    auto rows = std::make_shared<std::vector<Vector>>();
+    std::vector<Vector> pulled, tangents;
+    Model model(rows, args_);
+
+    int32_t num_negatives = args_->number_negatives;
+    if (burnin_) {
+        num_negatives /= 10;  // as per N&K
+    }
+    // each pair is stored as its source, target and negatives (local ids),
+    // and ends where the next begins (there may be fewer negatives)
+    std::vector<int32_t> pairs, ids, samples, line;
+    std::vector<size_t> pair_begin;
+    LinePosition position;
+    std::unordered_map<int32_t, int32_t> local_ids;
+    auto local_id = [&](int32_t id) {
+        auto it = local_ids.find(id);
+        if (it != local_ids.end()) {
+            return it->second;
+        }
+        int32_t local = ids.size();
+        local_ids[id] = local;
+        ids.push_back(id);
+        return local;
+    };
+
+    const int64_t max_tokens = dict_->ntokens_ / num_shards;
+    int64_t token_count = 0;
+    int64_t iter_count = 0;
+    LockStats stats;
+    clock_t start = clock();
+    real lr = start_lr;
+    real progress = 0.;
+    while (token_count < max_tokens) {
+        pairs.clear();
+        pair_begin.clear();
+        ids.clear();
+        local_ids.clear();
+        int64_t batch_tokens = 0;
+        while (batch_tokens < args_->batch_tokens && token_count < max_tokens) {
+            int32_t ntokens = dict_->get_chunk(ifs, line, subsampling_rng, position);
+            token_count += ntokens;
+            batch_tokens += ntokens;
+            for (int32_t w = position.begin; w < position.end; w++) {
+                for (int32_t c = -args_->window_size; c <= args_->window_size; c++) {
+                    if (c == 0 || w + c < 0 || w + c >= line.size() || line[w] == line[w + c]) {
+                        continue;
+                    }
+                    int32_t source = line[w];
+                    int32_t target = line[w + c];
+                    samples.clear();
+                    samples.push_back(target);
+                    draw_distinct_negatives(&source, 1, samples, 0, num_negatives, rng, stats);
+                    pair_begin.push_back(pairs.size());
+                    pairs.push_back(local_id(source));
+                    for (auto id : samples) {
+                        pairs.push_back(local_id(id));
+                    }
+                }
+            }
+        }
+        progress = std::min(1.0, real(token_count) / max_tokens);
+        lr = start_lr * (1.0 - progress) + end_lr * progress;
+
+        while (rows->size() < ids.size()) {
+            rows->push_back(Vector(args_->dimension));
+            pulled.push_back(Vector(args_->dimension));
+            tangents.push_back(Vector(args_->dimension));
+        }
+        client.pull(ids, *rows);
+        for (size_t n = 0; n < ids.size(); n++) {
+            std::copy(rows->at(n).data_, rows->at(n).data_ + args_->dimension, pulled[n].data_);
+        }
+        pair_begin.push_back(pairs.size());
+        for (size_t k = 0; k + 1 < pair_begin.size(); k++) {
+            samples.assign(pairs.begin() + pair_begin[k] + 1, pairs.begin() + pair_begin[k + 1]);
+            model.log_bilinear_negative_sampling(pairs[pair_begin[k]], samples, lr);
+            stats.pairs_trained++;
+        }
+        for (size_t n = 0; n < ids.size(); n++) {
+            log_map(pulled[n], rows->at(n), tangents[n]);
+        }
+        client.push(ids, tangents);
+
+        if (thread_id == 0 && iter_count % REPORTING_INTERVAL == 0) {
+            print_info(start, progress, token_count, lr, model.get_performance());
+        }
+        iter_count++;
+    }
+    if (thread_id == 0) {
+        print_info(start, progress, token_count, lr, model.get_performance());
+        std::cerr << std::endl;
+    }
+    ifs.close();
+    std::lock_guard<std::mutex> lock(lock_stats_mutex_);
+    lock_stats_.add(stats);
+}
+
+}
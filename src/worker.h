@@ -0,0 +1,32 @@
+#pragma once
+
+#include <memory>
+
+#include "args.h"
+#include "minkowski.h"
+
+namespace minkowski {
+
+/*
+ * Trains as one of several worker processes (-workers), which may run on
+ * different machines, against the parameter servers listed in -servers.
+ * Each thread of each worker streams its share of the corpus in batches of
+ * -batch-tokens tokens: it pulls the rows needed for the batch (the words of
+ * the batch and their negative samples), trains on its local copies, and
+ * pushes the change to each row back as a tangent vector.  Once all workers
+ * are done, worker 0 collects the rows and saves the vectors.
+ */
+class Worker : public Minkowski {
+protected:
+    void epoch_thread(int32_t thread_id, int32_t seed, int32_t epoch, real start_lr, real end_lr) override;
+
+public:
+    explicit Worker(std::shared_ptr<Args> args);
+
+    /*
+     * Train, then (if worker 0) save the vectors and shut down the servers.
+     */
+    void train();
+};
+
+}
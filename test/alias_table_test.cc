@@ -0,0 +1,57 @@
+#include "gtest/gtest.h"
+#include "alias_table.h"
+#include "real.h"
+#include <cmath>
+#include "random.h"
+#include <vector>
+
+namespace {
+
+TEST(AliasTableTest, exactProbabilities) {
+    std::vector<real> weights = {5., 1., 0., 2.5, 1.5};
+    minkowski::AliasTable table(weights);
+    EXPECT_EQ(5, table.size());
+    // exact up to the 32-bit resolution of the coin flips
+    for (auto i = 0; i < table.size(); ++i) {
+        EXPECT_NEAR(weights[i] / 10., table.probability(i), 1e-9);
+    }
+}
+
+TEST(AliasTableTest, smoothedUnigramProbabilities) {
+    // a Zipfian vocabulary, smoothed as for the negative samples
+    std::vector<real> weights;
+    real z = 0;
+    for (auto i = 1; i <= 1000; ++i) {
+        weights.push_back(std::pow(1e6 / i, 0.5));
+        z += weights.back();
+    }
+    minkowski::AliasTable table(weights);
+    for (auto i = 0; i < table.size(); ++i) {
+        EXPECT_NEAR(weights[i] / z, table.probability(i), 1e-9);
+    }
+}
+
+TEST(AliasTableTest, sampleFrequencies) {
+    std::vector<real> weights = {6., 3., 1.};
+    minkowski::AliasTable table(weights);
+    minkowski::Rng rng(1);
+    std::vector<int> counts(3, 0);
+    int draws = 1000000;
+    for (auto i = 0; i < draws; ++i) {
+        counts[table.sample(rng)]++;
+    }
+    EXPECT_NEAR(0.6, real(counts[0]) / draws, 0.005);
+    EXPECT_NEAR(0.3, real(counts[1]) / draws, 0.005);
+    EXPECT_NEAR(0.1, real(counts[2]) / draws, 0.005);
+}
+
+TEST(AliasTableTest, zeroWeightNeverSampled) {
+    std::vector<real> weights = {1., 0., 1.};
+    minkowski::AliasTable table(weights);
+    minkowski::Rng rng(1);
+    for (auto i = 0; i < 100000; ++i) {
+        EXPECT_NE(1, table.sample(rng));
+    }
+}
+
+}  // namespace
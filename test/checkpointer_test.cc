@@ -0,0 +1,79 @@
+#include "gtest/gtest.h"
+#include "checkpointer.h"
+#include "vector.h"
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+
+TEST(CheckpointerTest, writesSnapshotsInTheBackground) {
+    auto vectors = std::make_shared<std::vector<minkowski::Vector>>(4, minkowski::Vector(2));
+    auto flags = std::shared_ptr<std::vector<std::mutex>>(new std::vector<std::mutex>(4));
+    for (int32_t i = 0; i < 4; i++) {
+        vectors->at(i)[0] = i;
+    }
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool release = false;
+    std::vector<std::string> names;
+    std::vector<real> firsts;
+    minkowski::Checkpointer checkpointer(vectors, flags, nullptr, 3,
+        [&](const std::string& name, const std::vector<minkowski::Vector>& snapshot,
+            const std::vector<uint8_t>* changed) {
+            EXPECT_EQ(nullptr, changed);
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&]() { return release; });
+            EXPECT_EQ(3, snapshot.size()); // only the rows requested
+            names.push_back(name);
+            firsts.push_back(snapshot[2][0]);
+        });
+
+    EXPECT_TRUE(checkpointer.request("first", false, true));
+    // the snapshot was copied already, so later updates are not in it
+    vectors->at(2)[0] = 10.;
+    // still being written
+    EXPECT_FALSE(checkpointer.request("dropped", false, false));
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        release = true;
+    }
+    cv.notify_all();
+    EXPECT_TRUE(checkpointer.request("second", true, false));
+    checkpointer.finish();
+    ASSERT_EQ(2, names.size());
+    EXPECT_EQ("first", names[0]);
+    EXPECT_EQ(2., firsts[0]);
+    EXPECT_EQ("second", names[1]);
+    EXPECT_EQ(10., firsts[1]);
+}
+
+TEST(CheckpointerTest, copiesOnlyTheDirtyRows) {
+    auto vectors = std::make_shared<std::vector<minkowski::Vector>>(3, minkowski::Vector(1));
+    auto flags = std::shared_ptr<std::vector<std::mutex>>(new std::vector<std::mutex>(3));
+    auto dirty = std::make_shared<std::vector<uint8_t>>(3, 1);
+    std::vector<std::vector<uint8_t>> changes;
+    std::vector<real> lasts;
+    minkowski::Checkpointer checkpointer(vectors, flags, dirty, 3,
+        [&](const std::string&, const std::vector<minkowski::Vector>& snapshot,
+            const std::vector<uint8_t>* changed) {
+            changes.push_back(changed ? *changed : std::vector<uint8_t>());
+            lasts.push_back(snapshot[2][0]);
+        });
+
+    EXPECT_TRUE(checkpointer.request("full", true, true));
+    EXPECT_EQ(std::vector<uint8_t>(3, 0), *dirty);
+    vectors->at(2)[0] = 5.;
+    (*dirty)[2] = 1;
+    EXPECT_TRUE(checkpointer.request("delta", true, false, true));
+    checkpointer.finish();
+    ASSERT_EQ(2, changes.size());
+    EXPECT_TRUE(changes[0].empty()); // full
+    EXPECT_EQ(std::vector<uint8_t>({0, 0, 1}), changes[1]);
+    EXPECT_EQ(5., lasts[1]);
+    EXPECT_EQ(0, (*dirty)[2]);
+}
+
+}
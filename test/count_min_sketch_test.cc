@@ -0,0 +1,61 @@
+#include "gtest/gtest.h"
+#include "count_min_sketch.h"
+#include "random.h"
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+TEST(CountMinSketchTest, estimatesAreNeverTooLow) {
+    // many more keys than counters, so that they collide
+    minkowski::CountMinSketch sketch(4096);
+    EXPECT_EQ(256, sketch.width());
+    minkowski::Rng rng(7);
+    std::vector<uint64_t> keys;
+    std::vector<uint32_t> counts;
+    for (int32_t i = 0; i < 2000; i++) {
+        keys.push_back(rng());
+        counts.push_back(1 + i % 5);
+    }
+    uint32_t total_error = 0;
+    for (int32_t i = 0; i < keys.size(); i++) {
+        for (uint32_t c = 0; c < counts[i]; c++) {
+            sketch.add(keys[i]);
+        }
+    }
+    for (int32_t i = 0; i < keys.size(); i++) {
+        ASSERT_GE(sketch.estimate(keys[i]), counts[i]);
+        total_error += sketch.estimate(keys[i]) - counts[i];
+    }
+    EXPECT_GT(total_error, 0);
+}
+
+TEST(CountMinSketchTest, exactWithoutCollisions) {
+    minkowski::CountMinSketch sketch(1 << 20);
+    for (uint64_t key = 1; key <= 10; key++) {
+        for (uint64_t c = 0; c < key; c++) {
+            EXPECT_EQ(c + 1, sketch.add(key));
+        }
+    }
+    for (uint64_t key = 1; key <= 10; key++) {
+        EXPECT_EQ(key, sketch.estimate(key));
+    }
+    EXPECT_EQ(0, sketch.estimate(11));
+}
+
+TEST(CountMinSketchTest, raisedEstimatesAreCountedOn) {
+    minkowski::CountMinSketch sketch(1 << 20);
+    sketch.add(1);
+    sketch.raise(1, 7);
+    EXPECT_EQ(7, sketch.estimate(1));
+    sketch.raise(1, 3); // never lowered
+    EXPECT_EQ(8, sketch.add(1));
+    EXPECT_EQ(0, sketch.estimate(2));
+}
+
+TEST(CountMinSketchTest, tooLittleMemory) {
+    EXPECT_THROW(minkowski::CountMinSketch(16), std::invalid_argument);
+}
+
+}
@@ -0,0 +1,375 @@
+#include "gtest/gtest.h"
+#include "args.h"
+#include "dictionary.h"
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+TEST(DictionaryTest, vocabularyGrowsWithoutMovingWords) {
+    auto args = std::make_shared<minkowski::Args>();
+    args->min_count = 2;
+    args->save_vocab = "saved.vocab";
+    args->read_vocab = "saved.vocab";
+    args->grow_vocab = 1;
+    std::stringstream saved;
+    {
+        minkowski::Dictionary dict(args);
+        std::istringstream corpus("a a a b b c\n");
+        dict.determine_vocabulary(corpus);
+        ASSERT_EQ(2, dict.nwords_); // a and b, but not c or the end of line
+        dict.save_vocabulary(saved);
+    }
+    std::string file = saved.str();
+    minkowski::Dictionary dict(args);
+    dict.read_vocabulary(file.data(), file.data() + file.size());
+    EXPECT_EQ(2, dict.nwords_);
+    int32_t a = dict.get_id("a");
+    int32_t b = dict.get_id("b");
+    EXPECT_EQ(-1, dict.get_id("c"));
+
+    // c and the end of line reach -min-count with their earlier occurrences,
+    // d does not; they are appended in the order they are promoted
+    std::istringstream more("c d b\n");
+    dict.update_vocabulary(more);
+    EXPECT_EQ(4, dict.nwords_);
+    EXPECT_EQ(a, dict.get_id("a"));
+    EXPECT_EQ(b, dict.get_id("b"));
+    EXPECT_EQ(2, dict.get_id("c"));
+    EXPECT_EQ(3, dict.get_id(minkowski::Dictionary::EOS));
+    EXPECT_EQ(-1, dict.get_id("d"));
+    EXPECT_EQ(2, dict.words_[dict.get_id("c")].count);
+    EXPECT_EQ(3, dict.words_[b].count);
+    EXPECT_EQ(11, dict.ntokens_);
+}
+
+std::vector<std::pair<int32_t, int32_t>> chunked_pairs(const minkowski::Dictionary& dict, const std::string& text,
+                                                      int32_t window_size, int32_t max_tokens) {
+    std::istringstream in(text);
+    minkowski::Philox rng(7, 0);
+    minkowski::LinePosition position;
+    std::vector<int32_t> words;
+    std::vector<std::pair<int32_t, int32_t>> pairs;
+    while (in.peek() != EOF) {
+        dict.get_chunk(in, words, rng, position, max_tokens);
+        for (int32_t w = position.begin; w < position.end; w++) {
+            for (int32_t c = -window_size; c <= window_size; c++) {
+                if (c != 0 && w + c >= 0 && w + c < words.size()) {
+                    pairs.push_back(std::make_pair(words[w], words[w + c]));
+                }
+            }
+        }
+    }
+    return pairs;
+}
+
+TEST(DictionaryTest, chunksHaveThePairsOfTheirLine) {
+    auto args = std::make_shared<minkowski::Args>();
+    args->min_count = 1;
+    args->window_size = 3;
+    args->t = 0.05; // subsample the frequent words
+    std::string text;
+    for (int32_t i = 0; i < 200; i++) {
+        text += "w" + std::to_string(i * i % 17) + (i == 99 ? "\n" : " ");
+    }
+    text += "\n";
+    minkowski::Dictionary dict(args);
+    std::istringstream corpus(text);
+    dict.determine_vocabulary(corpus);
+
+    auto whole_lines = chunked_pairs(dict, text, args->window_size, INT_MAX);
+    EXPECT_GT(whole_lines.size(), 0);
+    for (int32_t max_tokens : {1, 2, 5, 13}) {
+        EXPECT_EQ(whole_lines, chunked_pairs(dict, text, args->window_size, max_tokens));
+    }
+}
+
+TEST(DictionaryTest, savedVocabularyIsThresholdedAfresh) {
+    auto args = std::make_shared<minkowski::Args>();
+    args->min_count = 2;
+    args->save_vocab = "saved.vocab";
+    std::stringstream saved;
+    minkowski::Dictionary counted(args);
+    std::istringstream corpus("a a a b b c d d e\nb\n");
+    counted.determine_vocabulary(corpus);
+    counted.save_vocabulary(saved);
+    std::string file = saved.str();
+
+    // as counted, with the same ids
+    minkowski::Dictionary same(args);
+    same.read_vocabulary(file.data(), file.data() + file.size());
+    ASSERT_EQ(counted.nwords_, same.nwords_);
+    EXPECT_EQ(counted.ntokens_, same.ntokens_);
+    for (int32_t i = 0; i < counted.nwords_; i++) {
+        EXPECT_EQ(counted.words_[i].word, same.words_[i].word);
+        EXPECT_EQ(counted.words_[i].count, same.words_[i].count);
+    }
+
+    // the words below the previous -min-count are kept too
+    args->min_count = 1;
+    minkowski::Dictionary lower(args);
+    lower.read_vocabulary(file.data(), file.data() + file.size());
+    EXPECT_EQ(6, lower.nwords_);
+    EXPECT_EQ(0, lower.get_id("a")); // three times, as b, but seen first
+    EXPECT_EQ(1, lower.get_id("b"));
+    EXPECT_GE(lower.get_id("e"), 0);
+
+    args->min_count = 3;
+    minkowski::Dictionary higher(args);
+    higher.read_vocabulary(file.data(), file.data() + file.size());
+    EXPECT_EQ(2, higher.nwords_);
+    EXPECT_EQ(-1, higher.get_id("d"));
+
+    std::string truncated = file.substr(0, file.size() - 1);
+    EXPECT_THROW(higher.read_vocabulary(truncated.data(), truncated.data() + truncated.size()), std::invalid_argument);
+
+    // the first word ending after the second, or before the strings
+    const int64_t first_end = 2 * sizeof(int32_t) + 3 * sizeof(int64_t) + 6 * sizeof(int64_t);
+    for (int64_t bad_end : {int64_t(3), int64_t(-1)}) {
+        std::string corrupt = file;
+        std::memcpy(&corrupt[first_end], &bad_end, sizeof(int64_t));
+        EXPECT_THROW(higher.read_vocabulary(corrupt.data(), corrupt.data() + corrupt.size()), std::invalid_argument);
+    }
+}
+
+TEST(DictionaryTest, rareWordsAreOnlyKeptToBeSaved) {
+    auto args = std::make_shared<minkowski::Args>();
+    args->min_count = 2;
+    std::stringstream saved;
+    minkowski::Dictionary counted(args);
+    std::istringstream corpus("a a a b b c d d e\nb\n");
+    counted.determine_vocabulary(corpus);
+    counted.save_vocabulary(saved);
+    std::string file = saved.str();
+
+    // without -save-vocab, c and e were not kept
+    args->min_count = 1;
+    minkowski::Dictionary lower(args);
+    lower.read_vocabulary(file.data(), file.data() + file.size());
+    EXPECT_EQ(counted.nwords_, lower.nwords_);
+    EXPECT_EQ(-1, lower.get_id("c"));
+}
+
+TEST(DictionaryTest, parallelCountingMatchesSequential) {
+    auto args = std::make_shared<minkowski::Args>();
+    args->min_count = 2;
+    std::string text;
+    for (int32_t i = 0; i < 300; i++) {
+        text += "w" + std::to_string(i * 7 % 23) + (i % 11 == 10 ? "\n" : " ");
+    }
+    text += "last words"; // no final line break
+    minkowski::Dictionary sequential(args);
+    std::istringstream in(text);
+    sequential.determine_vocabulary(in);
+
+    for (int32_t threads : {1, 3, 8, 64}) {
+        args->threads = threads;
+        minkowski::Dictionary parallel(args);
+        parallel.determine_vocabulary(text.data(), text.data() + text.size());
+        EXPECT_EQ(sequential.ntokens_, parallel.ntokens_);
+        ASSERT_EQ(sequential.nwords_, parallel.nwords_);
+        for (int32_t i = 0; i < sequential.nwords_; i++) {
+            EXPECT_EQ(sequential.words_[i].word, parallel.words_[i].word);
+            EXPECT_EQ(sequential.words_[i].count, parallel.words_[i].count);
+        }
+    }
+}
+
+TEST(DictionaryTest, tableGrowsWithTheVocabulary) {
+    auto args = std::make_shared<minkowski::Args>();
+    args->min_count = 2;
+    // many more words than the initial slots of the table
+    std::string text;
+    for (int32_t i = 0; i < 20000; i++) {
+        text += "w" + std::to_string(i) + " w" + std::to_string(i / 2) + "\n";
+    }
+    minkowski::Dictionary dict(args);
+    std::istringstream in(text);
+    dict.determine_vocabulary(in);
+    // w0 .. w9999 occur three times, the others once
+    EXPECT_EQ(10001, dict.nwords_);
+    for (int32_t i = 0; i < 20000; i++) {
+        int32_t id = dict.get_id("w" + std::to_string(i));
+        if (i < 10000) {
+            ASSERT_GE(id, 0);
+            EXPECT_EQ("w" + std::to_string(i), dict.words_[id].word);
+        } else {
+            EXPECT_EQ(-1, id);
+        }
+    }
+    EXPECT_EQ(0, dict.get_id(minkowski::Dictionary::EOS));
+}
+
+/*
+ * Exposes the growable table beside the frozen one.
+ */
+class FreezingDictionary : public minkowski::Dictionary {
+public:
+    explicit FreezingDictionary(std::shared_ptr<minkowski::Args> args) : Dictionary(args) {}
+
+    int32_t growable_id(const std::string& word) const {
+        return word2int_[find(word)];
+    }
+
+    bool frozen() const {
+        return !frozen_slots_.empty();
+    }
+
+    using Dictionary::freeze;
+    using Dictionary::record_occurrence;
+};
+
+TEST(DictionaryTest, frozenTableMatchesTheGrowableOne) {
+    auto args = std::make_shared<minkowski::Args>();
+    // words of every length around the eight characters hashed at a time
+    std::vector<minkowski::entry> words;
+    std::vector<std::string> absent = {"", "x"};
+    for (int32_t i = 0; i < 3000; i++) {
+        std::string word = std::string(i % 20, 'a' + i % 26) + std::to_string(i);
+        words.push_back(minkowski::entry{word, 1});
+        absent.push_back(word + "x");
+        absent.push_back(word.substr(1));
+        absent.push_back(word.substr(0, word.size() - 1) + "_");
+    }
+    FreezingDictionary dict(args);
+    dict.set_vocabulary(words);
+    ASSERT_TRUE(dict.frozen());
+    for (int32_t i = 0; i < words.size(); i++) {
+        EXPECT_EQ(i, dict.get_id(words[i].word));
+        EXPECT_EQ(i, dict.growable_id(words[i].word));
+    }
+    for (const std::string& word : absent) {
+        EXPECT_EQ(dict.growable_id(word), dict.get_id(word));
+    }
+
+    // grown, it is looked up in the growable table until frozen again
+    for (int32_t i = 0; i < 1000; i++) {
+        dict.record_occurrence("new" + std::to_string(i));
+    }
+    ASSERT_FALSE(dict.frozen());
+    EXPECT_EQ(3000, dict.get_id("new0"));
+    dict.freeze();
+    ASSERT_TRUE(dict.frozen());
+    for (int32_t i = 0; i < 1000; i++) {
+        EXPECT_EQ(3000 + i, dict.get_id("new" + std::to_string(i)));
+    }
+    for (int32_t i = 0; i < words.size(); i++) {
+        EXPECT_EQ(i, dict.get_id(words[i].word));
+    }
+    for (const std::string& word : absent) {
+        EXPECT_EQ(dict.growable_id(word), dict.get_id(word));
+    }
+    EXPECT_EQ(-1, dict.get_id("new1000"));
+}
+
+/*
+ * Exposes counting within memory, with a sketch and a table of any size.
+ */
+class SketchingDictionary : public minkowski::Dictionary {
+public:
+    explicit SketchingDictionary(std::shared_ptr<minkowski::Args> args) : Dictionary(args) {}
+
+    // the number of words the tables needed
+    int64_t count(const std::string& text, int64_t sketch_bytes, int64_t exact_words) {
+        int64_t needed_words = count_within_memory(text.data(), text.data() + text.size(),
+                                                   sketch_bytes, exact_words);
+        if (args_->verify_counts) {
+            verify_counts(text.data(), text.data() + text.size());
+        }
+        finish_vocabulary();
+        return needed_words;
+    }
+};
+
+// a Zipfian vocabulary of about a thousand words
+std::string zipfian_text() {
+    std::string text;
+    for (int32_t i = 0; i < 100000; i++) {
+        int32_t rank = i % 7 == 0 ? i : (i * 31) % 997;
+        text += "w" + std::to_string(rank % (1 + i % 500)) + (i % 20 == 19 ? "\n" : " ");
+    }
+    return text;
+}
+
+TEST(DictionaryTest, countingWithinMemoryFindsTheSameVocabulary) {
+    auto args = std::make_shared<minkowski::Args>();
+    args->min_count = 5;
+    args->threads = 3;
+    std::string text = zipfian_text();
+    minkowski::Dictionary exact(args);
+    exact.determine_vocabulary(text.data(), text.data() + text.size());
+
+    for (int32_t verify : {0, 1}) {
+        args->verify_counts = verify;
+        // 32 counters a row for each thread, so that the words collide
+        SketchingDictionary bounded(args);
+        EXPECT_GE(1 << 20, bounded.count(text, 3 * 512, 1 << 20));
+        EXPECT_EQ(exact.ntokens_, bounded.ntokens_);
+        if (verify) {
+            ASSERT_EQ(exact.nwords_, bounded.nwords_);
+        } else {
+            ASSERT_GE(bounded.nwords_, exact.nwords_);
+        }
+        int64_t overcounted = 0;
+        for (int32_t i = 0; i < exact.nwords_; i++) {
+            int32_t id = bounded.get_id(exact.words_[i].word);
+            ASSERT_GE(id, 0);
+            if (verify) {
+                EXPECT_EQ(exact.words_[i].count, bounded.words_[id].count);
+            } else {
+                EXPECT_GE(bounded.words_[id].count, exact.words_[i].count);
+            }
+            overcounted += bounded.words_[id].count - exact.words_[i].count;
+        }
+        if (verify) {
+            EXPECT_EQ(0, overcounted);
+        } else {
+            EXPECT_LT(0, overcounted);
+        }
+    }
+
+    // the same, in -count-memory megabytes
+    args->count_memory = 1;
+    minkowski::Dictionary bounded(args);
+    bounded.determine_vocabulary(text.data(), text.data() + text.size());
+    ASSERT_EQ(exact.nwords_, bounded.nwords_);
+}
+
+TEST(DictionaryTest, countingWithinMemoryKeepsTheFrequentWords) {
+    auto args = std::make_shared<minkowski::Args>();
+    args->min_count = 5;
+    args->threads = 3;
+    args->verify_counts = 0;
+    std::string text = zipfian_text();
+    minkowski::Dictionary exact(args);
+    exact.determine_vocabulary(text.data(), text.data() + text.size());
+    ASSERT_GT(exact.nwords_, 200);
+
+    // tables of 20 words for each thread, which fill up and are evicted
+    SketchingDictionary bounded(args);
+    const int64_t needed_words = bounded.count(text, 3 << 20, 3 * 20);
+    EXPECT_LT(bounded.nwords_, exact.nwords_);
+    for (int32_t i = 0; i < 10; i++) {
+        int32_t id = bounded.get_id(exact.words_[i].word);
+        ASSERT_GE(id, 0);
+        EXPECT_GE(bounded.words_[id].count, exact.words_[i].count);
+    }
+
+    // tables of the size reported, which do not
+    ASSERT_GT(needed_words, 3 * 20);
+    args->verify_counts = 1;
+    SketchingDictionary sized(args);
+    EXPECT_GE(needed_words, sized.count(text, 3 << 20, needed_words));
+    ASSERT_EQ(exact.nwords_, sized.nwords_);
+    for (int32_t i = 0; i < exact.nwords_; i++) {
+        EXPECT_EQ(exact.words_[i].count, sized.words_[sized.get_id(exact.words_[i].word)].count);
+    }
+}
+
+}
@@ -0,0 +1,61 @@
+#include "gtest/gtest.h"
+#include "huffman_tree.h"
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+TEST(HuffmanTreeTest, pathsAndCodes) {
+    minkowski::HuffmanTree tree({5, 3, 1, 1});
+    EXPECT_EQ(3, tree.internal_nodes());
+    // the two rarest words are merged first (node 4), then with word 1
+    // (node 5), and finally with word 0 at the root (node 6)
+    EXPECT_EQ(std::vector<int32_t>({6}), tree.path(0));
+    EXPECT_EQ(std::vector<bool>({true}), tree.code(0));
+    EXPECT_EQ(std::vector<int32_t>({5, 6}), tree.path(1));
+    EXPECT_EQ(std::vector<bool>({true, false}), tree.code(1));
+    EXPECT_EQ(std::vector<int32_t>({4, 5, 6}), tree.path(2));
+    EXPECT_EQ(std::vector<bool>({true, false, false}), tree.code(2));
+    EXPECT_EQ(std::vector<int32_t>({4, 5, 6}), tree.path(3));
+    EXPECT_EQ(std::vector<bool>({false, false, false}), tree.code(3));
+}
+
+TEST(HuffmanTreeTest, codesArePrefixFree) {
+    std::vector<int64_t> counts;
+    for (int64_t i = 1; i <= 100; i++) {
+        counts.push_back(100000 / i);
+    }
+    minkowski::HuffmanTree tree(counts);
+    for (int32_t i = 0; i < 100; i++) {
+        // the root is the last node, and paths ascend to it (the order in
+        // which their nodes are locked)
+        EXPECT_EQ(198, tree.path(i).back());
+        EXPECT_TRUE(std::is_sorted(tree.path(i).begin(), tree.path(i).end()));
+        for (int32_t j = 0; j < 100; j++) {
+            if (i == j) {
+                continue;
+            }
+            // codes read from the root; neither may be a prefix of the other
+            auto a = tree.code(i);
+            auto b = tree.code(j);
+            std::vector<bool> ra(a.rbegin(), a.rend()), rb(b.rbegin(), b.rend());
+            size_t common = std::min(ra.size(), rb.size());
+            EXPECT_FALSE(std::equal(ra.begin(), ra.begin() + common, rb.begin()));
+        }
+    }
+    // frequent words have paths no longer than rare ones
+    EXPECT_LE(tree.path(0).size(), tree.path(99).size());
+}
+
+TEST(HuffmanTreeTest, singleWord) {
+    minkowski::HuffmanTree tree({7});
+    EXPECT_EQ(0, tree.internal_nodes());
+    EXPECT_TRUE(tree.path(0).empty());
+}
+
+TEST(HuffmanTreeTest, unsortedCountsAreRejected) {
+    EXPECT_THROW(minkowski::HuffmanTree({1, 2}), std::invalid_argument);
+}
+
+}
@@ -0,0 +1,69 @@
+#include "gtest/gtest.h"
+#include "args.h"
+#include "model.h"
+#include "random.h"
+#include "real.h"
+#include "vector.h"
+#include <cmath>
+#include <memory>
+#include <vector>
+
+namespace {
+
+std::shared_ptr<std::vector<minkowski::Vector>> random_points(int32_t count, int32_t dimension) {
+    minkowski::Rng rng(3);
+    auto vectors = std::make_shared<std::vector<minkowski::Vector>>();
+    minkowski::Vector point(dimension);
+    for (int32_t i = 0; i < count; i++) {
+        random_hyperboloid_point(point, rng, 0.5);
+        vectors->push_back(point);
+    }
+    return vectors;
+}
+
+real centroid_score(const std::vector<minkowski::Vector>& vectors,
+                    const std::vector<int32_t>& context, const minkowski::Vector& target) {
+    minkowski::Vector centroid(vectors[0].size());
+    std::vector<const minkowski::Vector*> rows;
+    for (auto id : context) {
+        rows.push_back(&vectors[id]);
+    }
+    lorentzian_centroid(rows, centroid);
+    return minkowski_dot(centroid, target);
+}
+
+TEST(ModelTest, cbowMovesCentroidTowardsPositive) {
+    auto args = std::make_shared<minkowski::Args>();
+    args->dimension = 6;
+    auto vectors = random_points(5, args->dimension);
+    minkowski::Model model(vectors, args);
+    std::vector<int32_t> context = {1, 2, 3};
+    std::vector<int32_t> samples = {0};
+
+    // against the row before its update, so only the context has moved
+    minkowski::Vector positive(vectors->at(0));
+    real before = centroid_score(*vectors, context, positive);
+    model.cbow_negative_sampling(context, samples, 0.05);
+    real after = centroid_score(*vectors, context, positive);
+    EXPECT_GT(after, before);
+    for (int32_t i = 0; i < 5; i++) {
+        EXPECT_NEAR(-1., minkowski_dot(vectors->at(i), vectors->at(i)), 1e-9);
+    }
+}
+
+TEST(ModelTest, cbowMovesCentroidAwayFromNegatives) {
+    auto args = std::make_shared<minkowski::Args>();
+    args->dimension = 6;
+    auto vectors = random_points(5, args->dimension);
+    minkowski::Model model(vectors, args);
+    std::vector<int32_t> context = {1, 2};
+    std::vector<int32_t> samples = {0, 4};
+
+    minkowski::Vector negative(vectors->at(4));
+    real before = centroid_score(*vectors, context, negative);
+    model.cbow_negative_sampling(context, samples, 0.05);
+    real after = centroid_score(*vectors, context, negative);
+    EXPECT_LT(after, before);
+}
+
+}
@@ -0,0 +1,108 @@
+#include "gtest/gtest.h"
+#include "args.h"
+#include "minkowski.h"
+#include <unistd.h>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+std::string temp_path(const std::string& name) {
+    return "/tmp/minkowski-negatives-test-" + std::to_string(getpid()) + "-" + name;
+}
+
+/*
+ * Exposes the counts of pairs trained and of negatives drawn.
+ */
+class CountingMinkowski : public minkowski::Minkowski {
+public:
+    explicit CountingMinkowski(std::shared_ptr<minkowski::Args> args) : Minkowski(args) {}
+
+    const minkowski::LockStats& lock_stats() const {
+        return lock_stats_;
+    }
+};
+
+/*
+ * Train on a corpus of three words (and the end of line), with more negatives
+ * than there are words to draw them from, and return the counts of training.
+ */
+minkowski::LockStats train_small_vocabulary(std::shared_ptr<minkowski::Args> args) {
+    args->input = temp_path("input");
+    args->output = temp_path("output");
+    args->dimension = 4;
+    args->epochs = 1;
+    args->min_count = 1;
+    args->t = 1;  // no subsampling
+    args->number_negatives = 5;
+    std::ofstream(args->input) << "a b c a b c\nb c a\n";
+    CountingMinkowski minkowski(args);
+    minkowski.train();
+    std::remove(args->input.c_str());
+    return minkowski.lock_stats();
+}
+
+TEST(NegativeSamplingTest, drawsNoMoreNegativesThanThereAreWords) {
+    // waiting for the locks, or trying them (the negatives drawn already
+    // being held by this thread)
+    for (auto policy : {minkowski::lock_policy_name::sorted, minkowski::lock_policy_name::skip}) {
+        auto args = std::make_shared<minkowski::Args>();
+        args->threads = 1;
+        args->lock_policy = policy;
+        auto stats = train_small_vocabulary(args);
+        EXPECT_LT(0, stats.pairs_trained);
+        // two of the four words are the source and target of each pair
+        EXPECT_EQ(3 * stats.pairs_trained, stats.negatives_dropped);
+    }
+}
+
+TEST(NegativeSamplingTest, givesUpAfterTheRetries) {
+    auto args = std::make_shared<minkowski::Args>();
+    args->threads = 1;
+    args->lock_policy = minkowski::lock_policy_name::sorted;
+    args->negative_retries = 0;
+    auto stats = train_small_vocabulary(args);
+    EXPECT_LT(0, stats.pairs_trained);
+    EXPECT_LE(stats.negatives_rejected, stats.pairs_trained);
+}
+
+TEST(NegativeSamplingTest, drawsFewNegativesForMinibatches) {
+    auto args = std::make_shared<minkowski::Args>();
+    args->threads = 1;
+    args->engine = minkowski::engine_name::minibatch;
+    auto stats = train_small_vocabulary(args);
+    EXPECT_LT(0, stats.pairs_trained);
+    EXPECT_LT(0, stats.negatives_dropped);
+}
+
+TEST(NegativeSamplingTest, drawsFewNegativesForCbow) {
+    auto args = std::make_shared<minkowski::Args>();
+    args->threads = 1;
+    args->model = minkowski::model_name::cbow;
+    auto stats = train_small_vocabulary(args);
+    EXPECT_LT(0, stats.pairs_trained);
+    EXPECT_LT(0, stats.negatives_dropped);
+}
+
+TEST(NegativeSamplingTest, drawsFewNegativesForTheSchedule) {
+    auto args = std::make_shared<minkowski::Args>();
+    args->threads = 2;
+    args->lock_policy = minkowski::lock_policy_name::scheduled;
+    auto stats = train_small_vocabulary(args);
+    EXPECT_LT(0, stats.pairs_trained);
+    EXPECT_EQ(3 * stats.pairs_trained, stats.negatives_dropped);
+}
+
+TEST(NegativeSamplingTest, schedulesOnlyNegativeSampling) {
+    auto args = std::make_shared<minkowski::Args>();
+    args->threads = 2;
+    args->lock_policy = minkowski::lock_policy_name::scheduled;
+    args->loss = minkowski::loss_name::hs;
+    EXPECT_THROW(train_small_vocabulary(args), std::invalid_argument);
+    std::remove(args->input.c_str());
+}
+
+}
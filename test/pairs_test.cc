@@ -0,0 +1,81 @@
+#include "gtest/gtest.h"
+#include "args.h"
+#include "pairs.h"
+#include <unistd.h>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+std::string temp_path(const std::string& name) {
+    return "/tmp/minkowski-pairs-test-" + std::to_string(getpid()) + "-" + name;
+}
+
+/*
+ * Aggregate `contents`, return the pair file read back and its pairs, keyed
+ * by (source word, target word).
+ */
+minkowski::PairFile aggregate(std::shared_ptr<minkowski::Args> args, const std::string& contents,
+                              std::map<std::pair<std::string, std::string>, float>& weights) {
+    args->input = temp_path("input");
+    args->output = temp_path("output");
+    std::ofstream(args->input) << contents;
+    minkowski::PairAggregator(args).aggregate();
+    minkowski::PairFile file(args->output + ".pairs");
+    std::ifstream in(args->output + ".pairs", std::ios::binary);
+    std::vector<minkowski::WeightedPair> pairs;
+    file.read(in, 0, file.num_pairs, pairs);
+    for (auto& pair : pairs) {
+        weights[std::make_pair(file.words[pair.source].word, file.words[pair.target].word)] = pair.weight;
+    }
+    std::remove(args->input.c_str());
+    std::remove((args->output + ".pairs").c_str());
+    return file;
+}
+
+TEST(PairsTest, cooccurrenceCounts) {
+    auto args = std::make_shared<minkowski::Args>();
+    args->min_count = 1;
+    args->t = 0;
+    args->window_size = 1;
+    std::map<std::pair<std::string, std::string>, float> weights;
+    auto file = aggregate(args, "a b a\n", weights);
+    // the words, ordered by count, include the end of line
+    ASSERT_EQ(3, file.words.size());
+    EXPECT_EQ("a", file.words[0].word);
+    EXPECT_EQ(2, file.words[0].count);
+    EXPECT_EQ(2., (weights[{"a", "b"}]));
+    EXPECT_EQ(2., (weights[{"b", "a"}]));
+    EXPECT_EQ(1., (weights[{"a", "</s>"}]));
+    EXPECT_EQ(4, file.num_pairs);
+    EXPECT_DOUBLE_EQ(6., file.total_weight);
+}
+
+TEST(PairsTest, edgeList) {
+    auto args = std::make_shared<minkowski::Args>();
+    args->input_format = minkowski::input_format_name::edges;
+    std::map<std::pair<std::string, std::string>, float> weights;
+    auto file = aggregate(args, "dog mammal\ncat mammal 2.5\n\nmammal animal\n", weights);
+    // numbered by decreasing degree
+    ASSERT_EQ(4, file.words.size());
+    EXPECT_EQ("mammal", file.words[0].word);
+    EXPECT_EQ(3, file.words[0].count);
+    EXPECT_EQ(3, file.num_pairs);
+    EXPECT_EQ(1., (weights[{"dog", "mammal"}]));
+    EXPECT_EQ(2.5, (weights[{"cat", "mammal"}]));
+    EXPECT_EQ(1., (weights[{"mammal", "animal"}]));
+}
+
+TEST(PairsTest, rejectsOtherFiles) {
+    std::string path = temp_path("not-pairs");
+    std::ofstream(path) << "a b c\n";
+    EXPECT_THROW(minkowski::PairFile file(path), std::invalid_argument);
+    std::remove(path.c_str());
+}
+
+}
@@ -0,0 +1,215 @@
+#include "gtest/gtest.h"
+#include "args.h"
+#include "parameter_server.h"
+#include "transport.h"
+#include "worker.h"
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <thread>
+
+namespace {
+
+std::string temp_path(const std::string& name) {
+    return "/tmp/minkowski-ps-test-" + std::to_string(getpid()) + "-" + name;
+}
+
+/*
+ * Run `f` in a child process, returning its pid.
+ */
+pid_t fork_process(std::function<void()> f) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        try {
+            f();
+        } catch (...) {
+            _exit(1);
+        }
+        _exit(0);
+    }
+    return pid;
+}
+
+/*
+ * Run `count` servers and `count` workers for `args`, each in its own
+ * process, and expect all of them to succeed.
+ */
+void run_servers_and_workers(std::shared_ptr<minkowski::Args> args, int count) {
+    std::vector<pid_t> pids;
+    for (auto id = 0; id < count; ++id) {
+        pids.push_back(fork_process([&]() {
+            args->command = "server";
+            args->server_id = id;
+            minkowski::ParameterServer(args).serve();
+        }));
+        pids.push_back(fork_process([&]() {
+            args->command = "worker";
+            args->worker_id = id;
+            minkowski::Worker(args).train();
+        }));
+    }
+    for (auto pid : pids) {
+        int status;
+        ASSERT_EQ(pid, waitpid(pid, &status, 0));
+        EXPECT_TRUE(WIFEXITED(status));
+        EXPECT_EQ(0, WEXITSTATUS(status));
+    }
+}
+
+TEST(ParameterServerTest, unixTransportRoundTrip) {
+    std::string location;
+    auto transport = minkowski::get_transport("unix://" + temp_path("socket"), location);
+    auto listener = transport->listen(location);
+    std::thread echo([&]() {
+        auto connection = listener->accept();
+        minkowski::Message message;
+        while (connection->receive(message)) {
+            connection->send(message);
+        }
+    });
+    {
+        auto connection = transport->connect(location, 5);
+        minkowski::Message sent, received;
+        sent.type = 7;
+        sent.ids = {3, 1, 4};
+        sent.data = {1.5, -2.25};
+        connection->send(sent);
+        ASSERT_TRUE(connection->receive(received));
+        EXPECT_EQ(sent.type, received.type);
+        EXPECT_EQ(sent.ids, received.ids);
+        EXPECT_EQ(sent.data, received.data);
+    }
+    echo.join();
+}
+
+TEST(ParameterServerTest, refusesInvalidRequests) {
+    auto args = std::make_shared<minkowski::Args>();
+    std::string address = "unix://" + temp_path("refusing");
+    args->servers = address;
+    args->workers = 1;
+    args->dimension = 4;
+    minkowski::ParameterServer server(args);
+    std::thread serving([&]() { server.serve(); });
+
+    std::string location;
+    auto transport = minkowski::get_transport(address, location);
+    auto request = [&](std::shared_ptr<minkowski::Connection> connection, minkowski::message_type type,
+                       std::vector<int32_t> ids) {
+        minkowski::Message message;
+        message.type = uint32_t(type);
+        message.ids = ids;
+        connection->send(message);
+        EXPECT_TRUE(connection->receive(message));
+        return minkowski::message_type(message.type);
+    };
+    {
+        auto connection = transport->connect(location, 5);
+        EXPECT_EQ(minkowski::message_type::error, request(connection, minkowski::message_type(99), {}));
+        EXPECT_EQ(minkowski::message_type::error, request(connection, minkowski::message_type::pull, {0}));
+        EXPECT_EQ(minkowski::message_type::error, request(connection, minkowski::message_type::hello, {10, 5}));
+        EXPECT_EQ(minkowski::message_type::ack, request(connection, minkowski::message_type::hello, {10, 4}));
+        EXPECT_EQ(minkowski::message_type::error, request(connection, minkowski::message_type::hello, {11, 4}));
+        EXPECT_EQ(minkowski::message_type::error, request(connection, minkowski::message_type::pull, {10}));
+        EXPECT_EQ(minkowski::message_type::error, request(connection, minkowski::message_type::push, {1}));
+        EXPECT_EQ(minkowski::message_type::rows, request(connection, minkowski::message_type::pull, {9, 0}));
+    }
+    // a client that hangs up part way through a message costs only its connection
+    {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, location.c_str(), sizeof(addr.sun_path) - 1);
+        ASSERT_EQ(0, connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)));
+        // the header of a pull of 1000 ids, with no ids after it
+        uint64_t header[3] = {uint32_t(minkowski::message_type::pull), 1000, 0};
+        ASSERT_EQ(ssize_t(sizeof(header)), write(fd, header, sizeof(header)));
+        close(fd);
+    }
+    {
+        minkowski::ParameterClient client(args, 10);
+        std::vector<minkowski::Vector> rows(1, minkowski::Vector(4));
+        client.pull({3}, rows);
+        EXPECT_NEAR(-1., minkowski_dot(rows[0], rows[0]), 1e-6);
+        client.shutdown();
+    }
+    // once the client has hung up
+    serving.join();
+}
+
+TEST(ParameterServerTest, twoServersTwoWorkers) {
+    // a small corpus: random "sentences" over a vocabulary of 50 words
+    std::string input = temp_path("corpus.txt");
+    std::ofstream corpus(input);
+    minkowski::Rng rng(1);
+    for (auto line = 0; line < 200; ++line) {
+        for (auto w = 0; w < 50; ++w) {
+            corpus << "w" << rng.below(50) << " ";
+        }
+        corpus << "\n";
+    }
+    corpus.close();
+
+    auto args = std::make_shared<minkowski::Args>();
+    args->input = input;
+    args->output = temp_path("vectors");
+    args->servers = "unix://" + temp_path("server0") + ",unix://" + temp_path("server1");
+    args->workers = 2;
+    args->threads = 2;
+    args->dimension = 5;
+    args->epochs = 2;
+    args->min_count = 1;
+    args->batch_tokens = 100;
+
+    run_servers_and_workers(args, 2);
+
+    // worker 0 has saved the vectors, which should be on the hyperboloid
+    std::ifstream ifs(args->output + ".csv");
+    std::string line;
+    int rows = 0;
+    while (std::getline(ifs, line)) {
+        std::stringstream ss(line);
+        std::string word;
+        ss >> word;
+        minkowski::Vector vec(args->dimension);
+        for (auto i = 0; i < args->dimension; ++i) {
+            ss >> vec[i];
+        }
+        EXPECT_NEAR(-1., minkowski_dot(vec, vec), 1e-6);
+        rows++;
+    }
+    EXPECT_EQ(51, rows); // the words and the end-of-sentence token
+    std::remove(input.c_str());
+    std::remove((args->output + ".csv").c_str());
+}
+
+TEST(ParameterServerTest, workerTrainsSmallVocabulary) {
+    // fewer words than negatives
+    std::string input = temp_path("small.txt");
+    std::ofstream(input) << "a b c a b c\nb c a\n";
+    auto args = std::make_shared<minkowski::Args>();
+    args->input = input;
+    args->output = temp_path("small");
+    args->servers = "unix://" + temp_path("small-server");
+    args->workers = 1;
+    args->threads = 1;
+    args->dimension = 4;
+    args->epochs = 1;
+    args->min_count = 1;
+    args->t = 1;
+    args->number_negatives = 5;
+    run_servers_and_workers(args, 1);
+    EXPECT_TRUE(std::ifstream(args->output + ".csv").good());
+    std::remove(input.c_str());
+    std::remove((args->output + ".csv").c_str());
+}
+
+}  // namespace
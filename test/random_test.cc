@@ -0,0 +1,76 @@
+#include "gtest/gtest.h"
+#include "random.h"
+#include "real.h"
+#include <cmath>
+#include <cstdint>
+
+namespace {
+
+TEST(RandomTest, philoxKnownAnswers) {
+    // known answer tests from the Random123 distribution
+    uint32_t out[4];
+    minkowski::Philox zeros(0, 0);
+    zeros.block(0, 0, out);
+    EXPECT_EQ(0x6627e8d5u, out[0]);
+    EXPECT_EQ(0xe169c58du, out[1]);
+    EXPECT_EQ(0xbc57ac4cu, out[2]);
+    EXPECT_EQ(0x9b00dbd8u, out[3]);
+
+    minkowski::Philox pi(0xa4093822, 0x299f31d0);
+    pi.block(0x0370734413198a2eull, 0x85a308d3243f6a88ull, out);
+    EXPECT_EQ(0xd16cfe09u, out[0]);
+    EXPECT_EQ(0x94fdccebu, out[1]);
+    EXPECT_EQ(0x5001e420u, out[2]);
+    EXPECT_EQ(0x24126ea1u, out[3]);
+}
+
+TEST(RandomTest, philoxDependsOnKey) {
+    uint32_t a[4], b[4];
+    minkowski::Philox(1, 0).block(7, 3, a);
+    minkowski::Philox(1, 1).block(7, 3, b);
+    EXPECT_NE(a[0], b[0]);
+}
+
+TEST(RandomTest, rngIsReproducible) {
+    minkowski::Rng rng_a(42);
+    minkowski::Rng rng_b(42);
+    minkowski::Rng rng_c(43);
+    for (auto i = 0; i < 100; ++i) {
+        auto value = rng_a();
+        EXPECT_EQ(value, rng_b());
+        EXPECT_NE(value, rng_c());
+    }
+}
+
+TEST(RandomTest, below) {
+    minkowski::Rng rng(1);
+    int counts[3] = {0, 0, 0};
+    for (auto i = 0; i < 300000; ++i) {
+        auto value = rng.below(3);
+        ASSERT_LT(value, 3u);
+        counts[value]++;
+    }
+    for (auto i = 0; i < 3; ++i) {
+        EXPECT_NEAR(100000, counts[i], 1000);
+    }
+}
+
+TEST(RandomTest, uniformAndNormalMoments) {
+    minkowski::Rng rng(1);
+    int n = 1000000;
+    real uniform_sum = 0., normal_sum = 0., normal_sum_sqd = 0.;
+    for (auto i = 0; i < n; ++i) {
+        real u = rng.uniform();
+        ASSERT_GE(u, 0.);
+        ASSERT_LT(u, 1.);
+        uniform_sum += u;
+        real x = rng.normal(2.);
+        normal_sum += x;
+        normal_sum_sqd += x * x;
+    }
+    EXPECT_NEAR(0.5, uniform_sum / n, 0.005);
+    EXPECT_NEAR(0., normal_sum / n, 0.01);
+    EXPECT_NEAR(4., normal_sum_sqd / n, 0.05);
+}
+
+}  // namespace
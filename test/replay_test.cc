@@ -0,0 +1,66 @@
+#include "gtest/gtest.h"
+#include "args.h"
+#include "minkowski.h"
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string temp_path(const std::string& name) {
+    return "/tmp/minkowski-replay-test-" + std::to_string(getpid()) + "-" + name;
+}
+
+/*
+ * Exposes the mixing of the replayed lines.
+ */
+class ReplayingMinkowski : public minkowski::Minkowski {
+public:
+    explicit ReplayingMinkowski(std::shared_ptr<minkowski::Args> args) : Minkowski(args) {}
+
+    void mix(const std::string& path) {
+        mix_replay(path);
+    }
+};
+
+std::vector<std::string> sorted_lines(const std::string& path) {
+    std::ifstream in(path);
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(in, line)) {
+        lines.push_back(line);
+    }
+    std::sort(lines.begin(), lines.end());
+    return lines;
+}
+
+TEST(ReplayTest, mixesEveryLineOnce) {
+    auto args = std::make_shared<minkowski::Args>();
+    args->input = temp_path("input");
+    args->replay = temp_path("replay");
+    args->replay_fraction = 1.;
+    // an empty line, and a last line without a newline
+    std::ofstream(args->input) << "a b c\n\nd e\nf";
+    std::ofstream(args->replay) << "g h\ni\n";
+    ReplayingMinkowski(args).mix(temp_path("mixed"));
+    std::vector<std::string> expected = {"", "a b c", "d e", "f", "g h", "i"};
+    EXPECT_EQ(expected, sorted_lines(temp_path("mixed")));
+
+    args->replay_fraction = 0.;
+    ReplayingMinkowski(args).mix(temp_path("mixed"));
+    expected = {"", "a b c", "d e", "f"};
+    EXPECT_EQ(expected, sorted_lines(temp_path("mixed")));
+
+    args->replay = temp_path("missing");
+    EXPECT_THROW(ReplayingMinkowski(args).mix(temp_path("mixed")), std::invalid_argument);
+    for (auto path : {args->input, temp_path("replay"), temp_path("mixed")}) {
+        std::remove(path.c_str());
+    }
+}
+
+}
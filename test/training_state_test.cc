@@ -0,0 +1,123 @@
+#include "gtest/gtest.h"
+#include "args.h"
+#include "minkowski.h"
+#include "random.h"
+#include <unistd.h>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+
+namespace {
+
+std::string temp_path(const std::string& name) {
+    return "/tmp/minkowski-state-test-" + std::to_string(getpid()) + "-" + name;
+}
+
+std::string contents(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    return buffer.str();
+}
+
+/*
+ * Keeps a copy of the training state saved the `keep`th time in the middle
+ * of an epoch, as a run interrupted there would have left it.
+ */
+class InterruptedMinkowski : public minkowski::Minkowski {
+protected:
+    int32_t keep_;
+    int32_t saved_;
+
+    void save_state(bool mid_epoch) override {
+        Minkowski::save_state(mid_epoch);
+        if (mid_epoch && ++saved_ == keep_) {
+            std::ofstream(temp_path("saved.state"), std::ios::binary) << contents(args_->output + ".state");
+        }
+    }
+
+public:
+    InterruptedMinkowski(std::shared_ptr<minkowski::Args> args, int32_t keep) :
+        Minkowski(args), keep_(keep), saved_(0) {}
+
+    int32_t saved() const {
+        return saved_;
+    }
+};
+
+/*
+ * Train on a random corpus of `lines` lines without interruption, then again from the state
+ * saved in the middle of it, and return whether both give the same vectors.
+ */
+bool resumes_exactly(std::shared_ptr<minkowski::Args> args, int32_t lines) {
+    args->input = temp_path("input");
+    args->output = temp_path("uninterrupted");
+    args->dimension = 4;
+    args->epochs = 2;
+    args->min_count = 1;
+    {
+        std::ofstream input(args->input);
+        minkowski::Rng rng(3);
+        for (int32_t line = 0; line < lines; line++) {
+            for (int32_t i = 0; i < 10; i++) {
+                input << "w" << rng() % 40 << (i < 9 ? " " : "\n");
+            }
+        }
+    }
+    InterruptedMinkowski uninterrupted(args, 3);
+    uninterrupted.train();
+    EXPECT_LE(3, uninterrupted.saved());
+
+    auto resumed_args = std::make_shared<minkowski::Args>(*args);
+    resumed_args->output = temp_path("resumed");
+    resumed_args->resume = temp_path("saved.state");
+    minkowski::Minkowski(resumed_args).train();
+    bool same = contents(args->output + ".csv") == contents(resumed_args->output + ".csv");
+
+    for (auto path : {args->input, args->output + ".csv", args->output + ".state", resumed_args->output + ".csv",
+                      resumed_args->output + ".state", resumed_args->resume}) {
+        std::remove(path.c_str());
+    }
+    return same;
+}
+
+TEST(TrainingStateTest, resumesMidEpochExactly) {
+    auto args = std::make_shared<minkowski::Args>();
+    args->threads = 1;
+    args->state_tokens = 1500;
+    EXPECT_TRUE(resumes_exactly(args, 400));
+}
+
+TEST(TrainingStateTest, resumesScheduledTrainingExactly) {
+    auto args = std::make_shared<minkowski::Args>();
+    args->threads = 2;
+    args->lock_policy = minkowski::lock_policy_name::scheduled;
+    // states are saved between rounds of scheduling, of 10000 tokens a thread
+    args->state_tokens = 20000;
+    EXPECT_TRUE(resumes_exactly(args, 5000));
+}
+
+TEST(TrainingStateTest, rejectsOtherOptions) {
+    auto args = std::make_shared<minkowski::Args>();
+    args->threads = 1;
+    args->input = temp_path("input");
+    args->output = temp_path("output");
+    args->dimension = 4;
+    args->epochs = 1;
+    args->min_count = 1;
+    args->state_tokens = 1000000;
+    std::ofstream(args->input) << "a b c a b c\nb c a\n";
+    minkowski::Minkowski(args).train();
+
+    auto other_args = std::make_shared<minkowski::Args>(*args);
+    other_args->dimension = 5;
+    other_args->resume = args->output + ".state";
+    EXPECT_THROW(minkowski::Minkowski(other_args).train(), std::invalid_argument);
+    for (auto path : {args->input, args->output + ".csv", args->output + ".state"}) {
+        std::remove(path.c_str());
+    }
+}
+
+}
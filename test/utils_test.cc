@@ -0,0 +1,67 @@
+#include "gtest/gtest.h"
+#include "utils.h"
+#include "random.h"
+#include "real.h"
+#include "vector.h"
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+TEST(UtilsTest, memoryStreamSeeksAndReads) {
+    const std::string text = "the quick\nbrown fox\n";
+    minkowski::utils::MemoryStream in(text.data(), text.data() + text.size());
+    EXPECT_EQ(int64_t(text.size()), minkowski::utils::size(in));
+
+    std::string word;
+    minkowski::utils::seek(in, 10);
+    in >> word;
+    EXPECT_EQ("brown", word);
+    EXPECT_EQ(15, int64_t(in.tellg()));
+
+    // after reaching the end, a seek reads again from the given position
+    while (in >> word) {}
+    EXPECT_EQ("fox", word);
+    minkowski::utils::seek(in, 4);
+    in >> word;
+    EXPECT_EQ("quick", word);
+    in.seekg(-1, std::ios_base::end);
+    EXPECT_EQ('\n', in.get());
+    EXPECT_EQ(EOF, in.get());
+}
+
+std::string format(real value) {
+    char text[minkowski::utils::MAX_REAL_CHARS];
+    int32_t length = minkowski::utils::format_real(value, text);
+    EXPECT_EQ(std::strlen(text), length);
+    return text;
+}
+
+TEST(UtilsTest, realsAreFormattedAsByVectorOutput) {
+    std::vector<real> values = {0., -0., 0.1, -2.5, 1e-5, 123456., 1e100, 1.234567890123456789e20,
+                                std::numeric_limits<real>::max(), std::numeric_limits<real>::min(),
+                                std::numeric_limits<real>::denorm_min(), std::numeric_limits<real>::infinity(),
+                                -std::numeric_limits<real>::infinity(), std::nan("")};
+    minkowski::Rng rng(3);
+    for (int32_t i = 0; i < 100000; i++) {
+        uint64_t bits = rng();
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        values.push_back(value);
+    }
+    for (real value : values) {
+        minkowski::Vector vector(1);
+        vector[0] = value;
+        std::ostringstream written;
+        written << vector;
+        EXPECT_EQ(written.str(), format(value));
+    }
+    // subnormals are formatted, not flushed to zero
+    EXPECT_EQ("4.940656458412465e-324", format(std::numeric_limits<real>::denorm_min()));
+}
+
+}
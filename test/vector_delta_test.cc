@@ -0,0 +1,71 @@
+#include "gtest/gtest.h"
+#include "args.h"
+#include "dictionary.h"
+#include "utils.h"
+#include "vector.h"
+#include "vector_delta.h"
+#include "vector_file.h"
+#include <unistd.h>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string temp_path(const std::string& name) {
+    return "/tmp/minkowski-delta-test-" + std::to_string(getpid()) + "-" + name;
+}
+
+TEST(VectorDeltaTest, compactionAppliesTheChainInOrder) {
+    auto args = std::make_shared<minkowski::Args>();
+    args->dimension = 2;
+    args->output_format = minkowski::output_format_name::bin;
+    std::vector<minkowski::entry> words = {{"a", 3}, {"b", 2}, {"c", 1}};
+    std::vector<minkowski::Vector> vectors(3, minkowski::Vector(2));
+    for (int32_t i = 0; i < 3; i++) {
+        vectors[i][0] = i;
+    }
+    minkowski::VectorFile::save(temp_path("full"), words, vectors, 3, *args, 1);
+
+    // the first delta changes rows 0 and 2, the second row 2 again
+    vectors[0][0] = 10.;
+    vectors[2][0] = 12.;
+    std::vector<uint8_t> changed = {1, 0, 1};
+    {
+        std::ofstream out(temp_path("first.delta"), std::ios::binary);
+        minkowski::VectorDelta::write(out, temp_path("full.bin").substr(5), vectors, changed, 3, 2);
+    }
+    vectors[2][0] = 22.;
+    changed = {0, 0, 1};
+    {
+        std::ofstream out(temp_path("second.delta"), std::ios::binary);
+        minkowski::VectorDelta::write(out, temp_path("first.delta").substr(5), vectors, changed, 3, 2);
+    }
+    minkowski::VectorDelta second(temp_path("second.delta"));
+    ASSERT_EQ(1, second.ids.size());
+    EXPECT_EQ(2, second.ids[0]);
+    EXPECT_EQ(22., second.rows[0]);
+
+    args->input = temp_path("second.delta");
+    args->output = temp_path("compacted");
+    minkowski::DeltaCompactor(args).compact();
+    minkowski::utils::MappedFile file(temp_path("compacted.bin"));
+    minkowski::VectorFile compacted(file.data(), file.data() + file.size());
+    ASSERT_EQ(3, compacted.count());
+    EXPECT_EQ("c", compacted.word(2));
+    EXPECT_EQ(10., compacted.vector(0)[0]);
+    EXPECT_EQ(1., compacted.vector(1)[0]);
+    EXPECT_EQ(22., compacted.vector(2)[0]);
+
+    EXPECT_FALSE(minkowski::VectorDelta::is_delta(temp_path("full.bin")));
+    EXPECT_THROW(minkowski::VectorDelta(temp_path("full.bin")), std::invalid_argument);
+    for (auto name : {"full.bin", "first.delta", "second.delta", "compacted.bin"}) {
+        std::remove(temp_path(name).c_str());
+    }
+}
+
+}
@@ -0,0 +1,120 @@
+#include "gtest/gtest.h"
+#include "args.h"
+#include "dictionary.h"
+#include "random.h"
+#include "vector.h"
+#include "vector_file.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+TEST(VectorFileTest, writtenVectorsAreReadInPlace) {
+    minkowski::Args args;
+    args.dimension = 3;
+    std::vector<minkowski::entry> words = {{"the", 10}, {"minkowski", 5}, {"a", 2}};
+    std::vector<minkowski::Vector> vectors;
+    for (int32_t i = 0; i < 3; i++) {
+        minkowski::Vector vector(args.dimension);
+        for (int32_t j = 0; j < args.dimension; j++) {
+            vector[j] = 0.1 * i + j + 1. / 3.;
+        }
+        vectors.push_back(vector);
+    }
+    std::ostringstream out;
+    // the last word is not written
+    minkowski::VectorFile::write(out, words, vectors, 2, args);
+    // a copy, so that the matrix is aligned as in a mapped file
+    std::string written = out.str();
+    std::vector<double> buffer(written.size() / sizeof(double) + 1);
+    const char* begin = reinterpret_cast<const char*>(buffer.data());
+    std::copy(written.begin(), written.end(), reinterpret_cast<char*>(buffer.data()));
+    const char* end = begin + written.size();
+
+    ASSERT_TRUE(minkowski::VectorFile::is_vector_file(begin, end));
+    minkowski::VectorFile file(begin, end);
+    ASSERT_EQ(2, file.count());
+    EXPECT_EQ(3, file.dimension());
+    EXPECT_EQ(0, (file.vector(0) - reinterpret_cast<const real*>(begin)) * sizeof(real) %
+                 minkowski::VectorFile::ALIGNMENT);
+    for (int32_t i = 0; i < 2; i++) {
+        EXPECT_EQ(words[i].word, file.word(i));
+        for (int32_t j = 0; j < args.dimension; j++) {
+            EXPECT_EQ(vectors[i][j], file.vector(i)[j]); // exactly
+        }
+    }
+    EXPECT_THROW(minkowski::VectorFile(begin, end - 1), std::invalid_argument);
+    EXPECT_FALSE(minkowski::VectorFile::is_vector_file(begin + 1, end));
+}
+
+TEST(VectorFileTest, corruptOffsetsAreRejected) {
+    minkowski::Args args;
+    args.dimension = 2;
+    std::vector<minkowski::entry> words = {{"the", 10}, {"minkowski", 5}};
+    std::vector<minkowski::Vector> vectors(2, minkowski::Vector(args.dimension));
+    std::ostringstream out;
+    minkowski::VectorFile::write(out, words, vectors, 2, args);
+    const std::string written = out.str();
+
+    // the file, with the int64 at `offset` replaced by `value`
+    auto rejects = [&](int64_t offset, int64_t value) {
+        std::vector<double> buffer(written.size() / sizeof(double) + 1);
+        char* begin = reinterpret_cast<char*>(buffer.data());
+        std::copy(written.begin(), written.end(), begin);
+        std::memcpy(begin + offset, &value, sizeof(int64_t));
+        try {
+            minkowski::VectorFile file(begin, begin + written.size());
+        } catch (const std::invalid_argument&) {
+            return true;
+        }
+        return false;
+    };
+    EXPECT_FALSE(rejects(offsetof(minkowski::VectorFileHeader, count), 2));
+    // more rows than fit, with and without overflowing their size
+    EXPECT_TRUE(rejects(offsetof(minkowski::VectorFileHeader, count), 3));
+    EXPECT_TRUE(rejects(offsetof(minkowski::VectorFileHeader, count), int64_t(1) << 61));
+    EXPECT_TRUE(rejects(offsetof(minkowski::VectorFileHeader, dimension), int64_t(1) << 61));
+    // a string table outside of the file, or overlapping the header
+    EXPECT_TRUE(rejects(offsetof(minkowski::VectorFileHeader, strings_offset), int64_t(1) << 62));
+    EXPECT_TRUE(rejects(offsetof(minkowski::VectorFileHeader, strings_offset), -8));
+    EXPECT_TRUE(rejects(offsetof(minkowski::VectorFileHeader, strings_offset), 0));
+    EXPECT_TRUE(rejects(offsetof(minkowski::VectorFileHeader, matrix_offset), int64_t(1) << 62));
+    // the first word ending after the second, or before the characters
+    const int64_t first_end = sizeof(minkowski::VectorFileHeader);
+    EXPECT_TRUE(rejects(first_end, 13));
+    EXPECT_TRUE(rejects(first_end, -1));
+}
+
+TEST(VectorFileTest, textIsTheSameOnAnyNumberOfThreads) {
+    const int64_t dimension = 3;
+    std::vector<minkowski::entry> words;
+    std::vector<minkowski::Vector> vectors;
+    minkowski::Rng rng(11);
+    // more rows than a block of rows, so that threads format several
+    for (int32_t i = 0; i < 200000; i++) {
+        words.push_back({"w" + std::to_string(i), 1});
+        minkowski::Vector vector(dimension);
+        for (int32_t j = 0; j < dimension; j++) {
+            vector[j] = real(rng()) / 1e18 - 9.;
+        }
+        vectors.push_back(vector);
+    }
+    std::ostringstream single, parallel;
+    minkowski::VectorFile::write_csv(single, words, vectors, vectors.size() - 1, dimension, 1);
+    minkowski::VectorFile::write_csv(parallel, words, vectors, vectors.size() - 1, dimension, 3);
+    EXPECT_EQ(single.str(), parallel.str());
+
+    // as the rows were written one at a time, before
+    std::ostringstream lines;
+    for (int64_t i = 0; i < vectors.size() - 1; i++) {
+        lines << words[i].word << " " << vectors[i] << std::endl;
+    }
+    EXPECT_EQ(lines.str(), parallel.str());
+}
+
+}
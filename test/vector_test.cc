@@ -2,7 +2,7 @@
 #include "vector.h"
 #include "real.h"
 #include <cmath>
-#include <random>
+#include "random.h"
 
 namespace {
 
@@ -42,7 +42,7 @@ TEST(VectorTest, minkowskiDot) {
 }
 
 TEST(VectorTest, randomHyperboloidPoint) {
-    std::minstd_rand rng(1);
+    minkowski::Rng rng(1);
     minkowski::Vector vec_a(3);
     minkowski::Vector vec_b(3);
 
@@ -193,4 +193,70 @@ TEST(VectorTest, projectOntoTangentSpace) {
     EXPECT_FLOAT_EQ(0., mdp);
 }
 
+TEST(VectorTest, logMapInvertsGeodesicUpdate) {
+    minkowski::Rng rng(1);
+    minkowski::Vector base(4);
+    random_hyperboloid_point(base, rng, 0.5);
+    // a tangent vector at base
+    minkowski::Vector tangent(4);
+    tangent[0] = 0.3;
+    tangent[1] = -0.2;
+    tangent[2] = 0.5;
+    tangent[3] = 0.;
+    tangent.project_onto_tangent_space(base);
+    real dist = std::sqrt(minkowski_dot(tangent, tangent));
+
+    minkowski::Vector point(base);
+    minkowski::Vector unit_tangent(tangent);
+    unit_tangent.multiply(1. / dist);
+    point.geodesic_update(unit_tangent, dist);
+
+    minkowski::Vector recovered(4);
+    log_map(base, point, recovered);
+    for (auto i = 0; i < 4; ++i) {
+        EXPECT_NEAR(tangent[i], recovered[i], 1e-9);
+    }
+}
+
+TEST(VectorTest, minkowskiGemm) {
+    // 2 x 3 and 5 x 3 matrices (so that both code paths are exercised)
+    real a[] = {1., 0.5, -2.,
+                0.25, 2., 3.};
+    real b[] = {0., 0.5, 1.,
+                1., 1., 1.,
+                -1., 2., 0.5,
+                3., 0., -1.,
+                0.5, 0.5, 0.5};
+    real c[10];
+    minkowski::minkowski_gemm(a, b, c, 2, 5, 3);
+    for (auto i = 0; i < 2; ++i) {
+        for (auto j = 0; j < 5; ++j) {
+            real expected = a[i * 3] * b[j * 3] + a[i * 3 + 1] * b[j * 3 + 1] - a[i * 3 + 2] * b[j * 3 + 2];
+            EXPECT_FLOAT_EQ(expected, c[i * 5 + j]);
+        }
+    }
+}
+
+TEST(VectorTest, lorentzianCentroid) {
+    // two points equidistant from the basepoint, in opposite directions
+    real dist = 0.7;
+    minkowski::Vector point_a(3);
+    point_a[0] = std::sinh(dist);
+    point_a[1] = 0.;
+    point_a[2] = std::cosh(dist);
+    minkowski::Vector point_b(point_a);
+    point_b[0] = -point_b[0];
+
+    minkowski::Vector centroid(3);
+    lorentzian_centroid({&point_a, &point_b}, centroid);
+    // the centroid is the basepoint
+    EXPECT_NEAR(0., centroid[0], 1e-12);
+    EXPECT_NEAR(0., centroid[1], 1e-12);
+    EXPECT_FLOAT_EQ(1., centroid[2]);
+    // ... and for a single point, is the point itself
+    lorentzian_centroid({&point_a}, centroid);
+    EXPECT_FLOAT_EQ(point_a[0], centroid[0]);
+    EXPECT_FLOAT_EQ(point_a[2], centroid[2]);
+}
+
 }  // namespace